@@ -1,6 +1,7 @@
 // Copyright Configured Things Ltd and CHERIoT Contributors.
 // SPDX-License-Identifier: MIT
 
+#include <algorithm>
 #include <cheri.hh>
 #include <compartment.h>
 #include <cstdlib>
@@ -8,11 +9,15 @@
 #include <errno.h>
 #include <fail-simulator-on-error.h>
 #include <futex.h>
+#include <limits.h>
 #include <locks.hh>
+#include <queue.h>
+#include <riscvreg.h>
 #include <string.h>
 #include <thread.h>
 
 #include "config_broker.h"
+#include "lz.h"
 
 // Import some useful things from the CHERI namespace.
 using namespace CHERI;
@@ -20,8 +25,159 @@ using namespace CHERI;
 /// Debugging can be enable with "xmake --config --debug-config_broker=true"
 using Debug = ConditionalDebug<DEBUG_CONFIG_BROKER, "Config Broker">;
 
+/**
+ * Thresholds on the broker's remaining heap quota at which it starts
+ * to release memory that it can restore later.  These can be set with
+ * "xmake --config --broker-heap-low=<bytes> --broker-heap-critical=<bytes>"
+ */
+#ifndef CONFIG_BROKER_HEAP_LOW
+#	define CONFIG_BROKER_HEAP_LOW 1024
+#endif
+#ifndef CONFIG_BROKER_HEAP_CRITICAL
+#	define CONFIG_BROKER_HEAP_CRITICAL 256
+#endif
+
+/**
+ * Items with the ConfigCompressed flag that are smaller than this are
+ * still held as they are, as the saving would be small and consumers
+ * can then use the data pointer directly.
+ */
+static constexpr size_t CompressMinSize = 64;
+
+/**
+ * Size of the buffer values are compressed into before the result is
+ * copied to the heap, which can be set with
+ * "xmake --config --broker-compress-max=<bytes>".  A value that doesn't
+ * compress to fit is held as it is.
+ */
+#ifndef CONFIG_BROKER_COMPRESS_MAX
+#	define CONFIG_BROKER_COMPRESS_MAX 1024
+#endif
+
 namespace
 {
+	struct TrieNode;
+
+	/**
+	 * Broker statistics, and a lock to protect them.  This is only
+	 * ever held briefly to update or read the values, so can be taken
+	 * with any other lock held.
+	 */
+	ConfigBrokerStats stats;
+	FlagLock          lockStats;
+
+	/**
+	 * Buffer to compress values into.  Updates to different items can
+	 * be committed concurrently, so this has its own lock.
+	 */
+	uint8_t  compressBuffer[CONFIG_BROKER_COMPRESS_MAX];
+	FlagLock lockCompress;
+
+	/**
+	 * Lock for an item, which records how long it is held and how
+	 * long threads have to wait for it.  Acquires first try with a
+	 * zero timeout, so the cycles spent waiting are only measured
+	 * when the lock is contended.
+	 *
+	 * The per-item statistics are only updated with the lock held, so
+	 * need no further protection.
+	 */
+	class ItemLock
+	{
+		FlagLockPriorityInherited flag;
+
+		uint64_t acquired;      // Cycle count when the lock was taken
+		uint16_t holder;        // Thread holding the lock
+		uint32_t acquires;      // Times the lock has been taken
+		uint32_t waits;         // Times a thread has had to wait
+		uint64_t totalHold;     // Total cycles the lock has been held
+		uint32_t maxHold;       // Longest time the lock has been held
+		uint32_t maxWait;       // Longest time a thread has waited
+		uint16_t maxWaitHolder; // Holder during the longest wait
+		uint16_t maxWaitWaiter; // Thread that waited longest
+
+		static uint32_t saturate(uint64_t cycles)
+		{
+			return (cycles > UINT32_MAX) ? UINT32_MAX : cycles;
+		}
+
+		void acquired_by_caller()
+		{
+			acquired = rdcycle64();
+			holder   = thread_id_get();
+			acquires++;
+		}
+
+		public:
+		void lock()
+		{
+			Timeout t{0};
+			if (flag.try_lock(&t))
+			{
+				acquired_by_caller();
+				return;
+			}
+
+			// The holder may change while we wait, but this is
+			// the thread we are queued behind and which inherits
+			// our priority.
+			auto blockedBy = holder;
+			auto start     = rdcycle64();
+			flag.lock();
+			auto waited = rdcycle64() - start;
+
+			acquired_by_caller();
+			waits++;
+			if (waited > maxWait)
+			{
+				maxWait       = saturate(waited);
+				maxWaitHolder = blockedBy;
+				maxWaitWaiter = holder;
+			}
+
+			LockGuard g{lockStats};
+			stats.lockWaits++;
+			stats.lockWaitCycles += waited;
+		}
+
+		bool try_lock(Timeout *timeout)
+		{
+			if (!flag.try_lock(timeout))
+			{
+				return false;
+			}
+			acquired_by_caller();
+			return true;
+		}
+
+		void unlock()
+		{
+			auto held = rdcycle64() - acquired;
+			totalHold += held;
+			if (held > maxHold)
+			{
+				maxHold = saturate(held);
+			}
+			flag.unlock();
+		}
+
+		/**
+		 * Read the statistics for the lock.  Must be called with
+		 * the lock held, which is not included in the hold times.
+		 */
+		void read_stats(ConfigLockStats *result)
+		{
+			result->acquires       = acquires - 1;
+			result->waits          = waits;
+			result->maxHoldCycles  = maxHold;
+			result->meanHoldCycles = saturate(
+			  (acquires > 1) ? totalHold / (acquires - 1) : 0);
+			result->maxWaitCycles  = maxWait;
+			result->maxWaitHolder  = maxWaitHolder;
+			result->maxWaitWaiter  = maxWaitWaiter;
+		}
+	};
+
 	/// Internal view of a Config Item.
 	struct InternalConfigitem
 	{
@@ -31,27 +187,149 @@ namespace
 		size_t                    size;     // size of the created object
 		uint32_t                  minTicks; // Min system ticks between updates
 		uint64_t                  nextUpdate; // Time of next valid update
-		FlagLockPriorityInherited lock; // lock to prevent concurrent changes
+		uint32_t                  maxInput; // Max length of a value, or 0
+		uint32_t                  parseBudget; // Overrun threshold in cycles, or 0
+		ItemLock                  lock; // lock to prevent concurrent changes
 		int __cheri_callback (*parser)(const void *src, void *dst);
-		InternalConfigitem *next;
+		const void *defaultValue; // Set if the default can be reloaded
+		bool        compressed;   // Hold values compressed
+		size_t      storedSize;   // Size of data if it is compressed, or 0
+		ConfigTrace trace;        // How the current value was set
+		struct MultiParserState *multiParser; // Set if this has several outputs
+		bool                 isOutput;   // Output of a multi-output parser
+		struct DerivedState *derived;    // Set if this is a derived item
+		struct Dependent    *dependents; // Derived items that use this one
+		struct Subscription *subscriptions; // Queues to post changes to
+		struct Watch        *watches;       // Bitmaps to mark changes in
+		TrieNode            *node;       // Position in the name index
+		InternalConfigitem  *next;
+	};
+
+	/**
+	 * Additional state for the input item of a multi-output parser.
+	 * The outputs are held in address order, which is also the order
+	 * in which their locks are acquired, with argIndex mapping each one
+	 * back to the position the parser expects it in.
+	 */
+	struct MultiParserState
+	{
+		int __cheri_callback (*parse)(const void *src,
+		                              void       *dst[],
+		                              size_t      numDst);
+		size_t              numOutputs;
+		InternalConfigitem *outputs[MaxParserOutputs];
+		size_t              argIndex[MaxParserOutputs];
+	};
+
+	/**
+	 * Additional state for a derived item.  The inputs are held in
+	 * address order, which is also the order in which their locks
+	 * are acquired, with argIndex mapping each one back to the
+	 * position the compute callback expects it in.
+	 */
+	struct DerivedState
+	{
+		int __cheri_callback (*compute)(const void *inputs[],
+		                                size_t      numInputs,
+		                                void       *dst);
+		size_t              numInputs;
+		InternalConfigitem *inputs[MaxDerivedConfigInputs];
+		size_t              argIndex[MaxDerivedConfigInputs];
+		uint32_t            inputVersions[MaxDerivedConfigInputs];
+		bool                computed; // Set after the first compute
+		bool                evicted;  // Value released under memory pressure
+	};
+
+	/// A message queue subscribed to changes in an item.
+	struct Subscription
+	{
+		CHERI_SEALED(struct MessageQueue *) queue;
+		const ConfigName *owner;   // Read capability used to subscribe
+		uint32_t          id;      // Subscriber's id for the item
+		uint32_t          flags;   // ConfigSubscribeFlags
+		uint32_t          dropped; // Records discarded since the last post
+		Subscription     *next;
 	};
 
+	/// A consumer's changed-item bitmap watching an item.
+	struct Watch
+	{
+		std::atomic<uint32_t> *changeBits; // Start of the bitmap
+		std::atomic<uint32_t> *word;       // Word holding the item's bit
+		uint32_t               mask;       // The item's bit
+		const ConfigName      *owner;      // Read capability used to watch
+		Watch                 *next;
+	};
+
+	/// Entry in the list of derived items that depend on an item.
+	struct Dependent
+	{
+		InternalConfigitem *item;
+		Dependent          *next;
+	};
+
+	/**
+	 * Node in the index of config items.  Item names are a hierarchy
+	 * of segments separated by '/', and each node represents one
+	 * segment.  A node may have an item (if its path is the name of an
+	 * item), children (if its path is a prefix of other items), or both.
+	 *
+	 * Each node also has an aggregate version which is incremented
+	 * whenever any item at or below the node changes, so that a consumer
+	 * with a prefix capability can wait on a single futex for the whole
+	 * subtree.
+	 */
+	struct TrieNode
+	{
+		const char           *segment;       // Start of this segment
+		size_t                segmentLength; // Length of this segment
+		std::atomic<uint32_t> version;       // Aggregate version of subtree
+		InternalConfigitem   *item;          // Item at this path, if any
+		TrieNode             *parent;
+		TrieNode             *children;
+		TrieNode             *sibling;
+	};
+
+	/**
+	 * Root of the index, which represents the empty prefix.  Lookups
+	 * take time proportional to the length of the name rather than the
+	 * number of items.  As with the items themselves nodes are never
+	 * deleted, and the total number is limited by the set of static
+	 * sealed capabilities.
+	 */
+	TrieNode trieRoot;
+
 	/**
-	 * Set of config data items.  At scale we'd need to hold this in
-	 * std::map so we can do an easy lookup by name, but for now a very
-	 * simple link list is fine as the only operations we need are to
-	 * add a new item and search for an item (there is no concept of
-	 * deleting an item). The total number of items is limited by the
-	 * the set of static sealed capabilities.
+	 * List of all config items, in order of creation, for operations
+	 * that need to visit every item.
 	 */
 	InternalConfigitem *configData = nullptr;
 
+	/// Lock to protect changes to the index and item list.
+	FlagLock lockFindOrCreate;
+
+	/// Lock held while releasing memory, so only one thread does so.
+	FlagLock lockPressure;
+
+	/// Incremented after any change to a watched item - used as a futex.
+	std::atomic<uint32_t> changeSequence;
+
+	/// How short of memory the broker is.
+	enum class Pressure
+	{
+		None,
+		Low,
+		Critical,
+	};
+
 /*
  * Keys for unsealing the various types of operation
  */
 #define CONFIG_WRITE STATIC_SEALING_TYPE(WriteConfigKey)
 #define CONFIG_READ STATIC_SEALING_TYPE(ReadConfigKey)
+#define CONFIG_READ_PREFIX STATIC_SEALING_TYPE(ReadConfigPrefixKey)
 #define CONFIG_PARSER STATIC_SEALING_TYPE(ParserConfigKey)
+#define CONFIG_DERIVED STATIC_SEALING_TYPE(DerivedConfigKey)
 
 
 	/**
@@ -86,14 +364,78 @@ namespace
 			return nullptr;
 		}
 
-		Debug::log("Unsealed - Name: {} size: {} interval: {}",
+		Debug::log("Unsealed - Name: {} size: {} interval: {} budget: {} "
+		           "bytes {} cycles",
 		           token->Name,
 		           token->size,
-		           token->updateInterval);
+		           token->updateInterval,
+		           token->maxInput,
+		           token->parseBudget);
 
 		return token;
 	}
 
+	/**
+	 * Find the node for a name or prefix, creating any missing nodes
+	 * along the path.  Empty segments are ignored, so "led/", "/led"
+	 * and "led" all refer to the same node.  Must be called with
+	 * lockFindOrCreate held.
+	 */
+	TrieNode *find_or_create_node(const char *name)
+	{
+		TrieNode   *node = &trieRoot;
+		const char *p    = name;
+
+		while (*p != '\0')
+		{
+			// Find the extent of the next segment
+			const char *segment = p;
+			while (*p != '\0' && *p != '/')
+			{
+				p++;
+			}
+			size_t segmentLength = p - segment;
+			if (*p == '/')
+			{
+				p++;
+			}
+			if (segmentLength == 0)
+			{
+				continue;
+			}
+
+			TrieNode *child = node->children;
+			while (child != nullptr &&
+			       (child->segmentLength != segmentLength ||
+			        strncmp(child->segment, segment, segmentLength) != 0))
+			{
+				child = child->sibling;
+			}
+
+			if (child == nullptr)
+			{
+				child = new (std::nothrow) TrieNode();
+				if (child == nullptr)
+				{
+					return nullptr;
+				}
+
+				// The segment points into the name from the token that
+				// triggered the creation, since sealed objects are
+				// guaranteed not to be deallocated.
+				child->segment       = segment;
+				child->segmentLength = segmentLength;
+				child->version       = 0;
+				child->parent        = node;
+				child->sibling       = node->children;
+				node->children       = child;
+			}
+			node = child;
+		}
+
+		return node;
+	}
+
 	/**
 	 * Find a Config by name.  If it doesn't already exist
 	 * create one.  Use a LockGuard to protect against two
@@ -102,15 +444,17 @@ namespace
 
 	InternalConfigitem *find_or_create_config(const char *name)
 	{
-		static FlagLock lockFindOrCreate;
-		LockGuard       g{lockFindOrCreate};
+		LockGuard g{lockFindOrCreate};
 
-		for (auto c = configData; c != nullptr; c = c->next)
+		TrieNode *node = find_or_create_node(name);
+		if (node == nullptr)
 		{
-			if (strcmp(c->name, name) == 0)
-			{
-				return c;
-			}
+			return nullptr;
+		}
+
+		if (node->item != nullptr)
+		{
+			return node->item;
 		}
 
 		// Allocate a Config object
@@ -125,6 +469,10 @@ namespace
 			c->version = 0;
 			c->data    = nullptr;
 
+			// Add it to the index
+			c->node    = node;
+			node->item = c;
+
 			// Insert it at the start of the list
 			c->next    = configData;
 			configData = c;
@@ -133,179 +481,1350 @@ namespace
 		return c;
 	};
 
-} // namespace
+	/**
+	 * Find the node for a prefix, creating it if needed so that
+	 * a consumer can wait for items that have not yet been created.
+	 */
+	TrieNode *find_or_create_prefix(const char *name)
+	{
+		LockGuard g{lockFindOrCreate};
+		return find_or_create_node(name);
+	}
 
-/**
- * Set a new value for the configuration item described by
- * the capability.
- */
-int __cheri_compartment("config_broker")
-  set_config(WriteConfigCapability sealedCap, const void *src, size_t srcLength)
-{
-	Debug::log(
-	  "thread {} Set config called for {}", thread_id_get(), sealedCap);
+	/**
+	 * Insert an item into an array of count items held in address
+	 * order, recording the argument position it was given in.  Returns
+	 * false if the item is already in the array.
+	 */
+	bool insert_sorted(InternalConfigitem **items,
+	                   size_t              *argIndex,
+	                   size_t               count,
+	                   InternalConfigitem  *item,
+	                   size_t               arg)
+	{
+		size_t j = count;
+		while (j > 0 && items[j - 1] >= item)
+		{
+			if (items[j - 1] == item)
+			{
+				return false;
+			}
+			items[j]    = items[j - 1];
+			argIndex[j] = argIndex[j - 1];
+			j--;
+		}
+		items[j]    = item;
+		argIndex[j] = arg;
+		return true;
+	}
 
-	// Check that we've been given a valid capability
-	auto token = name_capability_unseal(sealedCap, CONFIG_WRITE);
-	if (token == nullptr)
+	/**
+	 * Increment the aggregate version of every node above an item
+	 * and wake anyone waiting on them.
+	 */
+	void notify_prefixes(InternalConfigitem *c)
 	{
-		Debug::log("Invalid set config capability: {}", sealedCap);
-		return -EPERM;
+		for (auto n = c->node; n != nullptr; n = n->parent)
+		{
+			n->version++;
+			n->version.notify_all();
+		}
 	}
 
-	// Find or create a config structure
-	InternalConfigitem *c = find_or_create_config(token->Name);
-	if (c == nullptr)
+	/**
+	 * Post the current value of an item to a subscriber's queue.  This
+	 * never blocks, so if the queue is full either the new record or
+	 * (if coalescing) the oldest record is discarded.  Returns false if
+	 * the queue is no longer valid.  Must be called with the item's
+	 * lock held.
+	 */
+	bool post_update(InternalConfigitem *c, Subscription *sub)
 	{
-		Debug::log("Failed to create item {}", token->Name);
-		return -ENOMEM;
+		ConfigUpdate update;
+		update.name    = c->name;
+		update.id      = sub->id;
+		update.version = c->version.load();
+		update.data    = (c->storedSize > 0) ? nullptr : c->data;
+		update.dropped = sub->dropped;
+		update.trace   = c->trace;
+
+		Timeout t{0};
+		int     res = queue_send_sealed(&t, sub->queue, &update);
+		if (res == -ETIMEDOUT && (sub->flags & ConfigSubscribeCoalesce))
+		{
+			// Discard the oldest record, carrying forward its count of
+			// records that were discarded before it.
+			ConfigUpdate discard;
+			Timeout      t1{0};
+			if (queue_receive_sealed(&t1, sub->queue, &discard) == 0)
+			{
+				update.dropped += discard.dropped + 1;
+				Timeout t2{0};
+				res = queue_send_sealed(&t2, sub->queue, &update);
+			}
+		}
+
+		if (res == 0)
+		{
+			sub->dropped = 0;
+		}
+		else if (res == -ETIMEDOUT)
+		{
+			Debug::log("Queue full for {} id {}", c->name, sub->id);
+			sub->dropped = update.dropped + 1;
+		}
+		else
+		{
+			Debug::log("Failed to post {} to {}: {}", c->name, sub->queue, res);
+			return false;
+		}
+		return true;
 	}
 
-	// Guard against concurrent updates to this item
-	LockGuard g{c->lock};
+	/**
+	 * Post the current value of an item to all of its subscribers,
+	 * removing any whose queue is no longer valid.  Must be called with
+	 * the item's lock held.
+	 */
+	void post_updates(InternalConfigitem *c)
+	{
+		Subscription **prev = &c->subscriptions;
+		while (*prev != nullptr)
+		{
+			auto sub = *prev;
+			if (post_update(c, sub))
+			{
+				prev = &sub->next;
+			}
+			else
+			{
+				*prev = sub->next;
+				delete sub;
+			}
+		}
+	}
 
-	// Check we have a parser
-	if (c->parser == nullptr)
+	/**
+	 * Set the item's bit in each bitmap watching it, removing any that
+	 * are no longer valid, and then wake anyone waiting on the change
+	 * sequence.  Must be called with the item's lock held.
+	 */
+	void notify_watches(InternalConfigitem *c)
 	{
-		Debug::log("Parser not defined for {}", token->Name);
-		return -ENODEV;
+		if (c->watches == nullptr)
+		{
+			return;
+		}
+
+		Watch **prev = &c->watches;
+		while (*prev != nullptr)
+		{
+			auto w = *prev;
+			if (CHERI::Capability{w->word}.is_valid())
+			{
+				w->word->fetch_or(w->mask);
+				prev = &w->next;
+			}
+			else
+			{
+				Debug::log("Removing invalid watch on {}", c->name);
+				*prev = w->next;
+				delete w;
+			}
+		}
+
+		changeSequence++;
+		changeSequence.notify_all();
 	}
 
-	// Check rate limiting
-	auto     system_tick = thread_systemtick_get();
-	uint64_t tick =
-	  (static_cast<uint64_t>(system_tick.hi) << 32) + system_tick.lo;
-	if ((c->nextUpdate > 0) && (tick < c->nextUpdate))
+	/**
+	 * Create a read only view of a value.  Neither we nor the consumers
+	 * need to be able to update it, and it can't hold capabilities.
+	 */
+	void *read_only_value(void *data)
 	{
-		Debug::log(
-		  "Rate limit exceeded: tick {} next update {}", tick, c->nextUpdate);
-		return -EBUSY;
+		CHERI::Capability roData{data};
+		roData.permissions() &=
+		  roData.permissions().without(CHERI::Permission::Store) &
+		  roData.permissions().without(CHERI::Permission::LoadStoreCapability);
+		return roData;
 	}
-	c->nextUpdate = tick + c->minTicks;
 
-	// Allocate heap space for the new value
-	auto newData = malloc(c->size);
-	if (newData == nullptr)
+	/**
+	 * Work out how short of memory we will be after allocating
+	 * another needed bytes.
+	 */
+	Pressure pressure_level(size_t needed)
 	{
-		Debug::log("Failed to allocate space for {}", token->Name);
-		return -ENOMEM;
+		ssize_t remaining = heap_quota_remaining(MALLOC_CAPABILITY);
+		if (remaining < 0)
+		{
+			return Pressure::None;
+		}
+		remaining -= needed;
+		if (remaining < CONFIG_BROKER_HEAP_CRITICAL)
+		{
+			return Pressure::Critical;
+		}
+		if (remaining < CONFIG_BROKER_HEAP_LOW)
+		{
+			return Pressure::Low;
+		}
+		return Pressure::None;
 	}
 
-	// Create a write only Capability to pass to the parser so
-	// that it can't capture or read from it. This also clears
-	// the Load/Store Capability (MC) permission so the config data
-	// can only hold simple values.
-	CHERI::Capability woNewData{newData};
-	woNewData.permissions() &= {CHERI::Permission::Store};
+	/**
+	 * Release the values the broker holds that it can restore later.
+	 *
+	 * Under low pressure this releases default values, which can be
+	 * reloaded by copying them again from the parser.  When pressure
+	 * is critical it also releases the cached values of derived items,
+	 * which can be recomputed from their inputs.  Items which are
+	 * locked (including any held by the caller) are skipped, so this
+	 * can be called from any point in an update without the risk of
+	 * deadlock.
+	 *
+	 * A default value is only released if the item has no dependents,
+	 * as a derived item needs the value of all of its inputs.
+	 */
+	void relieve_pressure(Pressure level)
+	{
+		if (level == Pressure::None)
+		{
+			return;
+		}
 
-	// Create a read only Capability of the source data to pass
-	// to the parser so that it can't capture or change it. This
-	// also clears the Load/Store Capability (MC) permission which
-	// prevents capabilities being embedded in the source data.
-	//
-	// Set the bounds to the length of the source both to constrain
-	// it and to avoid having to pass it in as a separate value.
-	//
-	CHERI::Capability roSrc{src};
-	roSrc.permissions() &= {CHERI::Permission::Load};
-	roSrc.bounds() = srcLength;
+		Timeout t{0};
+		if (!lockPressure.try_lock(&t))
+		{
+			// Someone else is already releasing memory
+			return;
+		}
 
-	// Call the parser
-	if (c->parser(roSrc, woNewData) != 0)
-	{
-		Debug::log("Parser failed for {}", token->Name);
-		free(newData);
-		return -EINVAL;
-	}
+		uint32_t evictedDefaults = 0;
+		uint32_t evictedDerived  = 0;
+		size_t   bytesReclaimed  = 0;
+
+		for (auto c = configData; c != nullptr; c = c->next)
+		{
+			Timeout t1{0};
+			if (!c->lock.try_lock(&t1))
+			{
+				continue;
+			}
 
-	// Neither we nor the subscribers need to be able to update the
-	// value, so just track through a readOnly capability
-	CHERI::Capability roData{newData};
-	roData.permissions() &=
-	  roData.permissions().without(CHERI::Permission::Store) &
-	  roData.permissions().without(CHERI::Permission::LoadStoreCapability);
+			bool evict = false;
+			if (c->data != nullptr && c->version == 0 &&
+			    c->defaultValue != nullptr && c->dependents == nullptr)
+			{
+				evict = true;
+				evictedDefaults++;
+			}
+			else if (c->data != nullptr && level == Pressure::Critical &&
+			         c->derived != nullptr && c->derived->computed)
+			{
+				c->derived->computed = false;
+				c->derived->evicted  = true;
+				evict                = true;
+				evictedDerived++;
+			}
 
-	// Keep track of the old value so we can free it
-	auto oldData = c->data;
+			if (evict)
+			{
+				// Consumers should have their own claim on the value,
+				// so this only releases the broker's claim.
+				Debug::log("Releasing value of {} under memory pressure",
+				           c->name);
+				free(c->data);
+				c->data = nullptr;
+				bytesReclaimed += c->size;
+			}
 
-	// updated it
-	c->data = roData;
-	c->version++;
-	Debug::log("Data version {} set to {}", c->version.load(), c->data);
+			c->lock.unlock();
+		}
 
-	// Notify anyone waiting for the version to change.  Doing this before
-	// we free the old value reduces the risk of them using the old value
-	// after we free it, even though they should have their own claim.
-	Debug::log("Waking subscribers {}", c->version.load());
-	c->version.notify_all();
+		lockPressure.unlock();
 
-	// Free the old data value.  Any subscribers that received it should
-	// have their own claim on it if needed
-	if (oldData)
-	{
-		free(oldData);
+		LockGuard g{lockStats};
+		stats.pressureEvents++;
+		stats.evictedDefaults += evictedDefaults;
+		stats.evictedDerived += evictedDerived;
+		stats.bytesReclaimed += bytesReclaimed;
+	}
+
+	/**
+	 * Allocate space for a new value.  If this would leave the broker
+	 * short of memory, or the allocation fails, first release any
+	 * values that can be restored later.
+	 */
+	void *alloc_value(size_t size)
+	{
+		relieve_pressure(pressure_level(size));
+
+		void *data = malloc(size);
+		if (data == nullptr)
+		{
+			relieve_pressure(Pressure::Critical);
+			data = malloc(size);
+			if (data == nullptr)
+			{
+				LockGuard g{lockStats};
+				stats.allocFailures++;
+			}
+		}
+		return data;
+	}
+
+	/**
+	 * If an item is held compressed, compress a new value and free
+	 * the original.  Values that are small or don't compress are held
+	 * as they are.  Returns the value to commit, and sets storedSize to
+	 * its compressed size (or 0 if it is not compressed).
+	 */
+	void *compress_value(InternalConfigitem *c, void *value, size_t &storedSize)
+	{
+		storedSize = 0;
+		if (!c->compressed || c->size < CompressMinSize)
+		{
+			return value;
+		}
+
+		// Compress into the static buffer so that the only allocation
+		// is for the result.  It's only worth keeping if it saves at
+		// least one byte.
+		LockGuard g{lockCompress};
+		auto      space  = std::min(c->size - 1, sizeof(compressBuffer));
+		auto      length = lz_compress(
+		  static_cast<const uint8_t *>(value), c->size, compressBuffer, space);
+		if (length == 0)
+		{
+			return value;
+		}
+
+		void *compressed = alloc_value(length);
+		if (compressed == nullptr)
+		{
+			Debug::log("No space to hold {} compressed", c->name);
+			return value;
+		}
+		memcpy(compressed, compressBuffer, length);
+		free(value);
+		storedSize = length;
+		Debug::log("Compressed {} from {} to {} bytes", c->name, c->size, length);
+
+		return compressed;
+	}
+
+	/**
+	 * Publish a new value for an item and free the old one.  newData
+	 * must have been allocated from the broker's heap, and storedSize
+	 * is its size if it has been compressed.  trace holds the times
+	 * of the earlier stages of the update, if any.  Must be called
+	 * with the item's lock held.
+	 */
+	void commit_config(InternalConfigitem *c,
+	                   void               *newData,
+	                   size_t              storedSize = 0,
+	                   const ConfigTrace  &trace      = {})
+	{
+		// Keep track of the old value so we can free it
+		auto oldData = c->data;
+
+		c->trace        = trace;
+		c->trace.commit = rdcycle64();
+
+		// Neither we nor the subscribers need to be able to update the
+		// value, so just track through a readOnly capability
+		c->data       = read_only_value(newData);
+		c->storedSize = storedSize;
+		c->version++;
+		Debug::log("Data version {} set to {}", c->version.load(), c->data);
+
+		// Notify anyone waiting for the version to change.  Doing this before
+		// we free the old value reduces the risk of them using the old value
+		// after we free it, even though they should have their own claim.
+		Debug::log("Waking subscribers {}", c->version.load());
+		c->version.notify_all();
+		notify_prefixes(c);
+		post_updates(c);
+		notify_watches(c);
+
+		// Free the old data value.  Any subscribers that received it should
+		// have their own claim on it if needed
+		if (oldData)
+		{
+			free(oldData);
+		}
+	}
+
+	/**
+	 * Recompute a derived item if any of its inputs have changed
+	 * since it was last computed.
+	 *
+	 * The inputs are locked for the duration of the compute so that
+	 * their values can't be freed under it.  Derived items can't be
+	 * used as inputs, and the inputs are always locked in address
+	 * order after the derived item, so this can't deadlock with
+	 * another update.
+	 */
+	void update_derived(InternalConfigitem *d, bool force = false)
+	{
+		LockGuard g{d->lock};
+
+		// Registration may have failed after adding the dependency
+		auto derived = d->derived;
+		if (derived == nullptr)
+		{
+			return;
+		}
+		if (force)
+		{
+			derived->computed = false;
+			derived->evicted  = false;
+		}
+
+		for (size_t i = 0; i < derived->numInputs; i++)
+		{
+			derived->inputs[i]->lock.lock();
+		}
+
+		bool        changed  = !derived->computed;
+		bool        restored = derived->evicted;
+		const void *values[MaxDerivedConfigInputs];
+		for (size_t i = 0; i < derived->numInputs; i++)
+		{
+			auto input = derived->inputs[i];
+			auto v     = input->version.load();
+			if (v != derived->inputVersions[i])
+			{
+				changed                    = true;
+				restored                   = false;
+				derived->inputVersions[i] = v;
+			}
+			values[derived->argIndex[i]] = input->data;
+		}
+
+		if (changed)
+		{
+			derived->computed = true;
+			derived->evicted  = false;
+
+			void *newData = alloc_value(d->size);
+			if (newData == nullptr)
+			{
+				Debug::log("Failed to allocate space for {}", d->name);
+			}
+			else
+			{
+				// As for a parser the callback only gets a write only
+				// view of the new value, and a read only view of the
+				// inputs.  The input array is on our stack so is
+				// already local.
+				CHERI::Capability woNewData{newData};
+				woNewData.permissions() &= {CHERI::Permission::Store};
+
+				CHERI::Capability roValues{values};
+				roValues.permissions() &=
+				  roValues.permissions().without(CHERI::Permission::Store);
+				roValues.bounds() = derived->numInputs * sizeof(values[0]);
+
+				if (derived->compute(roValues, derived->numInputs, woNewData) !=
+				    0)
+				{
+					Debug::log("Compute failed for {}", d->name);
+					free(newData);
+				}
+				else if (restored)
+				{
+					// Recomputing a value released under memory pressure
+					// from the same inputs, so there is no new version.
+					d->data = read_only_value(newData);
+				}
+				else
+				{
+					commit_config(d, newData);
+				}
+			}
+		}
+
+		for (size_t i = derived->numInputs; i > 0; i--)
+		{
+			derived->inputs[i - 1]->lock.unlock();
+		}
+	}
+
+	/**
+	 * Recompute any derived items that depend on an item.  Must
+	 * be called without the item's lock held.  force is used when
+	 * the value has changed without a change in version, i.e. when
+	 * a default value has been set.
+	 */
+	void update_dependents(InternalConfigitem *c, bool force = false)
+	{
+		for (auto dep = c->dependents; dep != nullptr; dep = dep->next)
+		{
+			update_derived(dep->item, force);
+		}
+	}
+
+	/**
+	 * Set the default value of an item if it has not yet been set.
+	 * The default is copied to the heap so that consumers can treat
+	 * it in the same way as any other value (including making claims
+	 * on it), and it is served as version 0.
+	 */
+	int set_default(InternalConfigitem *c, const void *defaultValue)
+	{
+		if (!CHERI::check_pointer(defaultValue, c->size))
+		{
+			Debug::log("Invalid default value {} for {}", defaultValue, c->name);
+			return -EINVAL;
+		}
+
+		{
+			LockGuard g{c->lock};
+
+			// If the default is in global memory (as it is when defined
+			// with DEFINE_CONFIG_DEFAULT) we can keep a pointer to it, and
+			// release our copy if we run short of memory.
+			if (CHERI::Capability{defaultValue}.permissions().contains(
+			      CHERI::Permission::Global))
+			{
+				CHERI::Capability roDefault{defaultValue};
+				roDefault.permissions() &= {CHERI::Permission::Load,
+				                            CHERI::Permission::Global};
+				c->defaultValue = roDefault;
+			}
+
+			if (c->data != nullptr || c->version > 0)
+			{
+				// Already have a value
+				return 0;
+			}
+
+			auto newData = alloc_value(c->size);
+			if (newData == nullptr)
+			{
+				Debug::log("Failed to allocate default for {}", c->name);
+				return -ENOMEM;
+			}
+			memcpy(newData, defaultValue, c->size);
+			c->data = read_only_value(newData);
+
+			// The version doesn't change, but wake anyone that is already
+			// waiting so they can pick up the default.
+			Debug::log("Default set for {}", c->name);
+			c->version.notify_all();
+			notify_prefixes(c);
+			post_updates(c);
+			notify_watches(c);
+		}
+
+		update_dependents(c, true);
+		return 0;
+	}
+
+	/**
+	 * Restore a value that was released under memory pressure.  Must
+	 * be called without the item's lock held, as a derived item needs
+	 * to lock its inputs.
+	 */
+	void restore_value(InternalConfigitem *c)
+	{
+		if (c->derived != nullptr)
+		{
+			if (c->derived->evicted)
+			{
+				update_derived(c);
+			}
+			return;
+		}
+
+		LockGuard g{c->lock};
+		if (c->data == nullptr && c->version == 0 &&
+		    c->defaultValue != nullptr)
+		{
+			auto newData = alloc_value(c->size);
+			if (newData == nullptr)
+			{
+				Debug::log("Failed to reload default for {}", c->name);
+				return;
+			}
+			memcpy(newData, c->defaultValue, c->size);
+			c->data = read_only_value(newData);
+		}
+	}
+
+	/**
+	 * Check a parser capability gives an item the same size and
+	 * flags it already has from another parser.
+	 */
+	bool same_layout(InternalConfigitem *c, ConfigToken *token)
+	{
+		return token->size == c->size &&
+		       ((token->flags & ConfigCompressed) != 0) == c->compressed;
+	}
+
+	/**
+	 * Record the cycles taken by a parse, and check they were within
+	 * the item's budget.
+	 */
+	bool parse_within_budget(InternalConfigitem *c, const ConfigTrace &trace)
+	{
+		auto cycles  = trace.parseEnd - trace.parseStart;
+		bool overrun = (c->parseBudget > 0) && (cycles > c->parseBudget);
+
+		LockGuard g{lockStats};
+		if (cycles > stats.maxParseCycles)
+		{
+			stats.maxParseCycles = (cycles > UINT32_MAX) ? UINT32_MAX : cycles;
+		}
+		if (overrun)
+		{
+			stats.parseOverruns++;
+		}
+		return !overrun;
+	}
+
+	/**
+	 * Call a multi-output parser and, if it succeeds, commit all of
+	 * the outputs together.  Must be called with the input item's lock
+	 * held.
+	 */
+	int parse_multi(InternalConfigitem *c,
+	                const void         *roSrc,
+	                ConfigTrace        &trace)
+	{
+		auto  mp = c->multiParser;
+		void *newData[MaxParserOutputs];
+		void *args[MaxParserOutputs];
+
+		auto freeAll = [&](size_t count) {
+			for (size_t i = 0; i < count; i++)
+			{
+				free(newData[i]);
+			}
+		};
+
+		// Allocate each output and create a write only capability
+		// for it, as for a single parser.
+		for (size_t i = 0; i < mp->numOutputs; i++)
+		{
+			newData[i] = alloc_value(mp->outputs[i]->size);
+			if (newData[i] == nullptr)
+			{
+				Debug::log("Failed to allocate space for {}",
+				           mp->outputs[i]->name);
+				freeAll(i);
+				return -ENOMEM;
+			}
+			CHERI::Capability woNewData{newData[i]};
+			woNewData.permissions() &= {CHERI::Permission::Store};
+			args[mp->argIndex[i]] = woNewData;
+		}
+
+		// The parser can read the array of outputs but not change it.
+		CHERI::Capability roArgs{args};
+		roArgs.permissions() &=
+		  roArgs.permissions().without(CHERI::Permission::Store);
+		roArgs.bounds() = mp->numOutputs * sizeof(args[0]);
+
+		trace.parseStart = rdcycle64();
+		auto res         = mp->parse(roSrc, roArgs, mp->numOutputs);
+		trace.parseEnd   = rdcycle64();
+		bool withinBudget = parse_within_budget(c, trace);
+		if (res != 0)
+		{
+			Debug::log("Parser failed for {}", c->name);
+			freeAll(mp->numOutputs);
+			return -EINVAL;
+		}
+		if (!withinBudget)
+		{
+			Debug::log("Parser for {} exceeded its budget", c->name);
+			freeAll(mp->numOutputs);
+			return -ETIMEDOUT;
+		}
+
+		// Compress the outputs before taking their locks
+		size_t storedSize[MaxParserOutputs];
+		for (size_t i = 0; i < mp->numOutputs; i++)
+		{
+			newData[i] =
+			  compress_value(mp->outputs[i], newData[i], storedSize[i]);
+		}
+
+		// Hold all of the output locks while we commit, so anyone woken
+		// by the first commit can't read any of the outputs until all
+		// of them have their new value.
+		for (size_t i = 0; i < mp->numOutputs; i++)
+		{
+			mp->outputs[i]->lock.lock();
+		}
+		for (size_t i = 0; i < mp->numOutputs; i++)
+		{
+			commit_config(mp->outputs[i], newData[i], storedSize[i], trace);
+		}
+		for (size_t i = mp->numOutputs; i > 0; i--)
+		{
+			mp->outputs[i - 1]->lock.unlock();
+		}
+
+		return 0;
+	}
+
+	/**
+	 * Create a read only pointer to a version that can
+	 * be used as a futex for version changes.
+	 */
+	std::atomic<uint32_t> *read_only_futex(std::atomic<uint32_t> *version)
+	{
+		CHERI::Capability roFutex{version};
+		roFutex.permissions() &=
+		  roFutex.permissions().without(CHERI::Permission::Store);
+		return roFutex;
+	}
+
+	/**
+	 * Populate the external view of a config item.  Must be
+	 * called with the item's lock held.
+	 */
+	void read_config(InternalConfigitem *c, ConfigItem *result)
+	{
+		// Name is already read only as it came from the static
+		// static capability
+		result->name = c->name;
+
+		// Provide the version value at this point in time
+		result->version = c->version.load();
+
+		// Data is already a read only pointer.  A compressed value is
+		// no use to the consumer, who must use read_config_into()
+		result->data = (c->storedSize > 0) ? nullptr : c->data;
+
+		result->versionFutex = read_only_futex(&c->version);
+		result->trace        = c->trace;
+	}
+
+} // namespace
+
+/**
+ * Set a new value for the configuration item described by
+ * the capability.
+ */
+int __cheri_compartment("config_broker")
+  set_config(WriteConfigCapability sealedCap,
+             const void           *src,
+             size_t                srcLength,
+             const ConfigTrace    *providerTrace)
+{
+	Debug::log(
+	  "thread {} Set config called for {}", thread_id_get(), sealedCap);
+
+	// Check that we've been given a valid capability
+	auto token = name_capability_unseal(sealedCap, CONFIG_WRITE);
+	if (token == nullptr)
+	{
+		Debug::log("Invalid set config capability: {}", sealedCap);
+		return -EPERM;
+	}
+
+	// Take the provider's times, if any.  These are only used for
+	// diagnostics, so ignore them if we can't read them.
+	ConfigTrace trace = {};
+	if (providerTrace != nullptr && CHERI::check_pointer(providerTrace))
+	{
+		trace.ingest   = providerTrace->ingest;
+		trace.verified = providerTrace->verified;
+	}
+
+	// Find or create a config structure
+	InternalConfigitem *c = find_or_create_config(token->Name);
+	if (c == nullptr)
+	{
+		Debug::log("Failed to create item {}", token->Name);
+		return -ENOMEM;
+	}
+
+	// Guard against concurrent updates to this item
+	LockGuard g{c->lock};
+
+	// Check we have a parser
+	if (c->parser == nullptr && c->multiParser == nullptr)
+	{
+		Debug::log("Parser not defined for {}", token->Name);
+		return -ENODEV;
+	}
+
+	// Check the value is within the parser's maxInput before it
+	// counts towards the rate limit.  The parsers make a single pass
+	// over the value, so this is what bounds the time they can take.
+	if (c->maxInput > 0 && srcLength > c->maxInput)
+	{
+		Debug::log("Value of {} bytes for {} is larger than {}",
+		           srcLength,
+		           token->Name,
+		           c->maxInput);
+		LockGuard gs{lockStats};
+		stats.inputsTooLarge++;
+		return -EMSGSIZE;
+	}
+
+	// Check rate limiting
+	auto     system_tick = thread_systemtick_get();
+	uint64_t tick =
+	  (static_cast<uint64_t>(system_tick.hi) << 32) + system_tick.lo;
+	if ((c->nextUpdate > 0) && (tick < c->nextUpdate))
+	{
+		Debug::log(
+		  "Rate limit exceeded: tick {} next update {}", tick, c->nextUpdate);
+		return -EBUSY;
+	}
+	c->nextUpdate = tick + c->minTicks;
+
+	// Create a read only Capability of the source data to pass
+	// to the parser so that it can't capture or change it. This
+	// also clears the Load/Store Capability (MC) permission which
+	// prevents capabilities being embedded in the source data.
+	//
+	// Set the bounds to the length of the source both to constrain
+	// it and to avoid having to pass it in as a separate value.
+	//
+	CHERI::Capability roSrc{src};
+	roSrc.permissions() &= {CHERI::Permission::Load};
+	roSrc.bounds() = srcLength;
+
+	if (c->multiParser != nullptr)
+	{
+		auto mp  = c->multiParser;
+		auto res = parse_multi(c, roSrc, trace);
+		g.unlock();
+		if (res == 0)
+		{
+			for (size_t i = 0; i < mp->numOutputs; i++)
+			{
+				update_dependents(mp->outputs[i]);
+			}
+		}
+		return res;
+	}
+
+	// Allocate heap space for the new value
+	auto newData = alloc_value(c->size);
+	if (newData == nullptr)
+	{
+		Debug::log("Failed to allocate space for {}", token->Name);
+		return -ENOMEM;
+	}
+
+	// Create a write only Capability to pass to the parser so
+	// that it can't capture or read from it. This also clears
+	// the Load/Store Capability (MC) permission so the config data
+	// can only hold simple values.
+	CHERI::Capability woNewData{newData};
+	woNewData.permissions() &= {CHERI::Permission::Store};
+
+	// Call the parser
+	trace.parseStart = rdcycle64();
+	auto res         = c->parser(roSrc, woNewData);
+	trace.parseEnd   = rdcycle64();
+	bool withinBudget = parse_within_budget(c, trace);
+	if (res != 0)
+	{
+		Debug::log("Parser failed for {}", token->Name);
+		free(newData);
+		return -EINVAL;
+	}
+	if (!withinBudget)
+	{
+		Debug::log("Parser for {} exceeded its budget", token->Name);
+		free(newData);
+		return -ETIMEDOUT;
+	}
+
+	size_t storedSize;
+	newData = compress_value(c, newData, storedSize);
+	commit_config(c, newData, storedSize, trace);
+
+	// Derived items take their own locks on their inputs
+	g.unlock();
+	update_dependents(c);
+
+	return 0;
+}
+
+/**
+ * Get the current value of a Configuration item.  The data
+ * member will be nullptr if the item has not yet been set.
+ */
+ConfigItem __cheri_compartment("config_broker") get_config(ReadConfigCapability sealedCap)
+{
+	// Object to return.  Stack is initialised to zeros
+	ConfigItem result;
+
+	Debug::log(
+	  "thread {} get_config called with {}", thread_id_get(), sealedCap);
+
+	// Get the calling compartments name from
+	// its sealed capability
+	auto token = name_capability_unseal(sealedCap, CONFIG_READ);
+
+	if (token == nullptr)
+	{
+		// Didn't get passed a valid Read Capability
+		Debug::log("Invalid read config capability {}", sealedCap);
+		return result;
+	}
+
+	auto c = find_or_create_config(token->Name);
+	if (c == nullptr)
+	{
+		Debug::log("Failed to create item {}", token->Name);
+		return result;
+	}
+
+	// Reload the value if we released it under memory pressure
+	restore_value(c);
+
+	//
+	// lock to prevent concurrent set/get on the same
+	// item
+	LockGuard g{c->lock};
+
+	read_config(c, &result);
+
+	return result;
+}
+
+/**
+ * Copy the current value of a config item into the caller's buffer,
+ * decompressing it if needed.
+ */
+int __cheri_compartment("config_broker")
+  read_config_into(ReadConfigCapability sealedCap,
+                   void                *buffer,
+                   size_t               bufferLength,
+                   uint32_t            *version)
+{
+	Debug::log(
+	  "thread {} read_config_into called with {}", thread_id_get(), sealedCap);
+
+	auto token = name_capability_unseal(sealedCap, CONFIG_READ);
+	if (token == nullptr)
+	{
+		Debug::log("Invalid read config capability {}", sealedCap);
+		return -EPERM;
+	}
+
+	// Check we can write to the callers buffers
+	if (!CHERI::check_pointer<CHERI::PermissionSet{CHERI::Permission::Store}>(
+	      buffer, bufferLength) ||
+	    ((version != nullptr) &&
+	     !CHERI::check_pointer<CHERI::PermissionSet{CHERI::Permission::Store}>(
+	       version)))
+	{
+		Debug::log("Invalid buffers for {}", token->Name);
+		return -EINVAL;
+	}
+
+	auto c = find_or_create_config(token->Name);
+	if (c == nullptr)
+	{
+		Debug::log("Failed to create item {}", token->Name);
+		return -ENOENT;
+	}
+
+	restore_value(c);
+
+	LockGuard g{c->lock};
+
+	if (c->data == nullptr)
+	{
+		return -ENOENT;
+	}
+	if (bufferLength < c->size)
+	{
+		Debug::log("Buffer too small for {}", token->Name);
+		return -EINVAL;
+	}
+
+	if (c->storedSize > 0)
+	{
+		if (lz_decompress(static_cast<const uint8_t *>(c->data),
+		                  c->storedSize,
+		                  static_cast<uint8_t *>(buffer),
+		                  c->size) != static_cast<ssize_t>(c->size))
+		{
+			Debug::log("Failed to decompress {}", token->Name);
+			return -EINVAL;
+		}
+	}
+	else
+	{
+		memcpy(buffer, c->data, c->size);
+	}
+
+	if (version != nullptr)
+	{
+		*version = c->version.load();
+	}
+
+	return c->size;
+}
+
+/**
+ * Read the lock statistics for a config item.
+ */
+int __cheri_compartment("config_broker")
+  get_config_lock_stats(ReadConfigCapability sealedCap,
+                        ConfigLockStats     *result)
+{
+	auto token = name_capability_unseal(sealedCap, CONFIG_READ);
+	if (token == nullptr)
+	{
+		Debug::log("Invalid read config capability {}", sealedCap);
+		return -EPERM;
+	}
+
+	if (!CHERI::check_pointer<CHERI::PermissionSet{CHERI::Permission::Store}>(
+	      result))
+	{
+		return -EINVAL;
+	}
+
+	auto c = find_or_create_config(token->Name);
+	if (c == nullptr)
+	{
+		Debug::log("Failed to create item {}", token->Name);
+		return -ENOMEM;
+	}
+
+	LockGuard g{c->lock};
+	c->lock.read_stats(result);
+
+	return 0;
+}
+
+/**
+ * Subscribe a message queue to changes in a config item.
+ */
+int __cheri_compartment("config_broker")
+  subscribe_config(ReadConfigCapability sealedCap,
+                   CHERI_SEALED(struct MessageQueue *) queue,
+                   uint32_t id,
+                   uint32_t flags)
+{
+	Debug::log(
+	  "thread {} subscribe_config called with {}", thread_id_get(), sealedCap);
+
+	auto token = name_capability_unseal(sealedCap, CONFIG_READ);
+	if (token == nullptr)
+	{
+		Debug::log("Invalid read config capability {}", sealedCap);
+		return -EPERM;
+	}
+
+	auto c = find_or_create_config(token->Name);
+	if (c == nullptr)
+	{
+		Debug::log("Failed to create item {}", token->Name);
+		return -ENOMEM;
+	}
+
+	restore_value(c);
+
+	LockGuard g{c->lock};
+
+	// Each sealed capability is private to the compartment that
+	// defines it, so the unsealed token identifies the caller.
+	Subscription **prev  = &c->subscriptions;
+	size_t         total = 0;
+	size_t         owned = 0;
+	while (*prev != nullptr && (*prev)->queue != queue)
+	{
+		total++;
+		owned += ((*prev)->owner == token);
+		prev = &(*prev)->next;
+	}
+
+	Subscription *sub = *prev;
+
+	if (sub == nullptr)
+	{
+		if (total >= MaxConfigSubscriptions ||
+		    owned >= MaxConfigListenersPerCaller)
+		{
+			Debug::log("Too many subscriptions to {}", token->Name);
+			return -EBUSY;
+		}
+		sub = new (std::nothrow) Subscription();
+		if (sub == nullptr)
+		{
+			return -ENOMEM;
+		}
+		sub->queue = queue;
+		sub->owner = token;
+		sub->next  = nullptr;
+		*prev      = sub;
+	}
+	sub->id    = id;
+	sub->flags = flags;
+
+	// Give the subscriber the current value, if there is one
+	if (c->data != nullptr && !post_update(c, sub))
+	{
+		*prev = sub->next;
+		delete sub;
+		return -EINVAL;
 	}
 
 	return 0;
 }
 
 /**
- * Get the current value of a Configuration item.  The data
- * member will be nullptr if the item has not yet been set.
+ * Remove a message queue subscription from a config item.
+ */
+int __cheri_compartment("config_broker")
+  unsubscribe_config(ReadConfigCapability sealedCap,
+                     CHERI_SEALED(struct MessageQueue *) queue)
+{
+	auto token = name_capability_unseal(sealedCap, CONFIG_READ);
+	if (token == nullptr)
+	{
+		Debug::log("Invalid read config capability {}", sealedCap);
+		return -EPERM;
+	}
+
+	auto c = find_or_create_config(token->Name);
+	if (c == nullptr)
+	{
+		return -ENOENT;
+	}
+
+	LockGuard g{c->lock};
+
+	for (Subscription **prev = &c->subscriptions; *prev != nullptr;
+	     prev                = &(*prev)->next)
+	{
+		auto sub = *prev;
+		if (sub->queue == queue)
+		{
+			*prev = sub->next;
+			delete sub;
+			return 0;
+		}
+	}
+
+	return -ENOENT;
+}
+
+/**
+ * Watch a config item through a consumer's changed-item bitmap.
  */
-ConfigItem __cheri_compartment("config_broker") get_config(ReadConfigCapability sealedCap)
+int __cheri_compartment("config_broker")
+  watch_config(ReadConfigCapability   sealedCap,
+               std::atomic<uint32_t> *changeBits,
+               uint32_t               bit)
 {
-	// Object to return.  Stack is initialised to zeros
-	ConfigItem result;
-
 	Debug::log(
-	  "thread {} get_config called with {}", thread_id_get(), sealedCap);
+	  "thread {} watch_config called with {}", thread_id_get(), sealedCap);
 
-	// Get the calling compartments name from
-	// its sealed capability
 	auto token = name_capability_unseal(sealedCap, CONFIG_READ);
-
 	if (token == nullptr)
 	{
-		// Didn't get passed a valid Read Capability
 		Debug::log("Invalid read config capability {}", sealedCap);
-		return result;
+		return -EPERM;
+	}
+
+	// We keep a pointer to the bitmap, so it can't be on the stack
+	auto word = changeBits + (bit / 32);
+	if (!CHERI::check_pointer<CHERI::PermissionSet{
+	      CHERI::Permission::Load,
+	      CHERI::Permission::Store,
+	      CHERI::Permission::Global}>(changeBits,
+	                                  (bit / 32 + 1) * sizeof(*changeBits)))
+	{
+		Debug::log("Invalid change bitmap {} for bit {}", changeBits, bit);
+		return -EINVAL;
 	}
 
 	auto c = find_or_create_config(token->Name);
 	if (c == nullptr)
 	{
 		Debug::log("Failed to create item {}", token->Name);
-		return result;
+		return -ENOMEM;
 	}
 
-	//
-	// lock to prevent concurrent set/get on the same
-	// item
+	restore_value(c);
+
 	LockGuard g{c->lock};
 
-	//
-	// Populate the return object.
-	//
+	Watch *w     = c->watches;
+	size_t total = 0;
+	size_t owned = 0;
+	while (w != nullptr && w->changeBits != changeBits)
+	{
+		total++;
+		owned += (w->owner == token);
+		w = w->next;
+	}
+
+	if (w == nullptr)
+	{
+		if (total >= MaxConfigWatches || owned >= MaxConfigListenersPerCaller)
+		{
+			Debug::log("Too many watches on {}", token->Name);
+			return -EBUSY;
+		}
+		w = new (std::nothrow) Watch();
+		if (w == nullptr)
+		{
+			return -ENOMEM;
+		}
+		w->changeBits = changeBits;
+		w->owner      = token;
+		w->next       = c->watches;
+		c->watches    = w;
+	}
+	w->word = word;
+	w->mask = 1U << (bit % 32);
+
+	// Let the watcher know if there is already a value
+	if (c->data != nullptr)
+	{
+		w->word->fetch_or(w->mask);
+		changeSequence++;
+		changeSequence.notify_all();
+	}
+
+	return 0;
+}
+
+/**
+ * Remove a changed-item bitmap from a config item.
+ */
+int __cheri_compartment("config_broker")
+  unwatch_config(ReadConfigCapability   sealedCap,
+                 std::atomic<uint32_t> *changeBits)
+{
+	auto token = name_capability_unseal(sealedCap, CONFIG_READ);
+	if (token == nullptr)
+	{
+		Debug::log("Invalid read config capability {}", sealedCap);
+		return -EPERM;
+	}
+
+	auto c = find_or_create_config(token->Name);
+	if (c == nullptr)
+	{
+		return -ENOENT;
+	}
+
+	LockGuard g{c->lock};
 
-	// Name is already read only as it came from the static
-	// static capability
-	result.name = c->name;
+	for (Watch **prev = &c->watches; *prev != nullptr; prev = &(*prev)->next)
+	{
+		auto w = *prev;
+		if (w->changeBits == changeBits)
+		{
+			*prev = w->next;
+			delete w;
+			return 0;
+		}
+	}
 
-	// Provide the version value at this point in time
-	result.version = c->version.load();
+	return -ENOENT;
+}
 
-	// Data is already a read only pointer
-	result.data = c->data;
+/**
+ * Get a read only pointer to the change sequence.
+ */
+std::atomic<uint32_t> *__cheri_compartment("config_broker")
+  get_config_change_sequence()
+{
+	return read_only_futex(&changeSequence);
+}
 
-	// Create a readonly pointer to the version that can
-	// be used a futex for version changes.
-	CHERI::Capability roFutex{&c->version};
-	roFutex.permissions() &=
-	  roFutex.permissions().without(CHERI::Permission::Store);
-	result.versionFutex = roFutex;
+/**
+ * Get the aggregate version of a prefix and the current value of
+ * each item under it.
+ */
+int __cheri_compartment("config_broker")
+  get_config_prefix(ReadConfigPrefixCapability sealedCap,
+                    ConfigPrefix              *prefix,
+                    ConfigItem                *items,
+                    size_t                     maxItems)
+{
+	Debug::log(
+	  "thread {} get_config_prefix called with {}", thread_id_get(), sealedCap);
 
-	return result;
+	auto token = name_capability_unseal(sealedCap, CONFIG_READ_PREFIX);
+	if (token == nullptr)
+	{
+		Debug::log("Invalid read config prefix capability {}", sealedCap);
+		return -EPERM;
+	}
+
+	// Check we can write to the callers buffers
+	if (!CHERI::check_pointer<CHERI::PermissionSet{
+	      CHERI::Permission::Store, CHERI::Permission::LoadStoreCapability}>(
+	      prefix) ||
+	    ((maxItems > 0) &&
+	     !CHERI::check_pointer<CHERI::PermissionSet{
+	       CHERI::Permission::Store, CHERI::Permission::LoadStoreCapability}>(
+	       items, maxItems * sizeof(ConfigItem))))
+	{
+		Debug::log("Invalid buffers for prefix {}", token->Name);
+		return -EINVAL;
+	}
+
+	auto root = find_or_create_prefix(token->Name);
+	if (root == nullptr)
+	{
+		Debug::log("Failed to create prefix {}", token->Name);
+		return -ENOMEM;
+	}
+
+	// Read the aggregate version before any of the items so that
+	// a change to an item we have already read is seen as a new
+	// version by the caller.
+	prefix->name         = token->Name;
+	prefix->version      = root->version.load();
+	prefix->versionFutex = read_only_futex(&root->version);
+
+	// Walk the subtree depth first.  Nodes are never removed, so
+	// the only concurrent change is the insertion of new nodes at
+	// the head of a child list, which will be picked up by the
+	// aggregate version.
+	size_t count = 0;
+	auto   n     = root;
+	while (n != nullptr)
+	{
+		if (n->item != nullptr)
+		{
+			if (count < maxItems)
+			{
+				restore_value(n->item);
+				LockGuard g{n->item->lock};
+				read_config(n->item, &items[count]);
+			}
+			count++;
+		}
+
+		if (n->children != nullptr)
+		{
+			n = n->children;
+			continue;
+		}
+
+		while (n != root && n->sibling == nullptr)
+		{
+			n = n->parent;
+		}
+		n = (n == root) ? nullptr : n->sibling;
+	}
+
+	return (count > INT_MAX) ? INT_MAX : static_cast<int>(count);
 }
 
 /**
@@ -313,7 +1832,8 @@ ConfigItem __cheri_compartment("config_broker") get_config(ReadConfigCapability
  */
 int __cheri_compartment("config_broker")
   set_parser(ConfigCapability     sealedCap,
-             __cheri_callback int parser(const void *src, void *dst))
+             __cheri_callback int parser(const void *src, void *dst),
+             const void          *defaultValue)
 {
 	Debug::log(
 	  "thread {} set parser called with {}", thread_id_get(), sealedCap);
@@ -334,9 +1854,293 @@ int __cheri_compartment("config_broker")
 		return -1;
 	}
 
-	c->size     = token->size;
-	c->minTicks = MS_TO_TICKS(token->updateInterval);
-	c->parser   = parser;
+	if (c->derived != nullptr || c->multiParser != nullptr)
+	{
+		Debug::log("{} is a derived or multi-output item", token->Name);
+		return -1;
+	}
+
+	// An item can be set on its own as well as being the output of a
+	// multi-output parser, but may already hold a value from that
+	// parser so must keep the same size and flags.
+	if (c->isOutput && !same_layout(c, token))
+	{
+		Debug::log("{} doesn't match its multi-output parser", token->Name);
+		return -1;
+	}
+
+	// Derived items need to read their inputs directly
+	if ((token->flags & ConfigCompressed) && c->dependents != nullptr)
+	{
+		Debug::log("{} is an input so can't be compressed", token->Name);
+		return -1;
+	}
+
+	c->compressed = token->flags & ConfigCompressed;
+	c->size       = token->size;
+	c->minTicks    = MS_TO_TICKS(token->updateInterval);
+	c->maxInput    = token->maxInput;
+	c->parseBudget = token->parseBudget;
+	c->parser      = parser;
+
+	if (defaultValue != nullptr)
+	{
+		return set_default(c, defaultValue);
+	}
+
+	return 0;
+}
+
+/**
+ * Set a multi-output parser for a config item.
+ */
+int __cheri_compartment("config_broker")
+  set_multi_parser(ConfigCapability     sealedCap,
+                   ConfigCapability    *outputs,
+                   size_t               numOutputs,
+                   __cheri_callback int parse(const void *src,
+                                              void       *dst[],
+                                              size_t      numDst))
+{
+	Debug::log(
+	  "thread {} set multi parser called with {}", thread_id_get(), sealedCap);
+
+	ConfigToken *token = config_capability_unseal(sealedCap, CONFIG_PARSER);
+	if (token == nullptr)
+	{
+		Debug::log("Invalid set parser capability {}", sealedCap);
+		return -EPERM;
+	}
+
+	if (numOutputs == 0 || numOutputs > MaxParserOutputs ||
+	    !CHERI::check_pointer<CHERI::PermissionSet{
+	      CHERI::Permission::Load, CHERI::Permission::LoadStoreCapability}>(
+	      outputs, numOutputs * sizeof(outputs[0])))
+	{
+		Debug::log("Invalid outputs for {}", token->Name);
+		return -EINVAL;
+	}
+
+	auto c = find_or_create_config(token->Name);
+	if (c == nullptr)
+	{
+		Debug::log("Failed to create item {}", token->Name);
+		return -ENOMEM;
+	}
+
+	// The input holds no value, so can't be used as an output or as
+	// the input to a derived item.
+	if (c->parser != nullptr || c->derived != nullptr || c->isOutput ||
+	    c->dependents != nullptr)
+	{
+		Debug::log("{} can't have a multi-output parser", token->Name);
+		return -EINVAL;
+	}
+
+	auto mp = new (std::nothrow) MultiParserState();
+	if (mp == nullptr)
+	{
+		return -ENOMEM;
+	}
+	mp->parse      = parse;
+	mp->numOutputs = numOutputs;
+
+	// The caller must be allowed to set the parser for each of the
+	// outputs.  Keep them sorted by address to give a fixed lock order.
+	ConfigToken *outputTokens[MaxParserOutputs];
+	for (size_t i = 0; i < numOutputs; i++)
+	{
+		outputTokens[i] = config_capability_unseal(outputs[i], CONFIG_PARSER);
+		auto output     = (outputTokens[i] == nullptr)
+		                    ? nullptr
+		                    : find_or_create_config(outputTokens[i]->Name);
+		if (output == nullptr || output == c || output->derived != nullptr ||
+		    output->multiParser != nullptr ||
+		    ((output->parser != nullptr || output->isOutput) &&
+		     !same_layout(output, outputTokens[i])) ||
+		    ((outputTokens[i]->flags & ConfigCompressed) &&
+		     output->dependents != nullptr) ||
+		    !insert_sorted(mp->outputs, mp->argIndex, i, output, i))
+		{
+			Debug::log("Invalid output {} for {}", outputs[i], token->Name);
+			delete mp;
+			return -EINVAL;
+		}
+	}
+
+	// The parser can only be registered once, as set_config uses the
+	// state after it has released the lock on the input.
+	LockGuard g{c->lock};
+	if (c->multiParser != nullptr)
+	{
+		Debug::log("Multi-output parser already set for {}", token->Name);
+		delete mp;
+		return -EEXIST;
+	}
+
+	for (size_t i = 0; i < numOutputs; i++)
+	{
+		auto output        = mp->outputs[i];
+		auto outputToken   = outputTokens[mp->argIndex[i]];
+		output->size       = outputToken->size;
+		output->compressed = outputToken->flags & ConfigCompressed;
+		output->isOutput   = true;
+	}
+
+	c->size        = 0;
+	c->minTicks    = MS_TO_TICKS(token->updateInterval);
+	c->maxInput    = token->maxInput;
+	c->parseBudget = token->parseBudget;
+	c->multiParser = mp;
+
+	return 0;
+}
+
+/**
+ * Define a derived config item.
+ */
+int __cheri_compartment("config_broker")
+  set_derived(ConfigCapability      sealedCap,
+              ReadConfigCapability *inputs,
+              size_t                numInputs,
+              __cheri_callback int  compute(const void *inputs[],
+                                           size_t      numInputs,
+                                           void       *dst))
+{
+	Debug::log(
+	  "thread {} set derived called with {}", thread_id_get(), sealedCap);
+
+	ConfigToken *token = config_capability_unseal(sealedCap, CONFIG_DERIVED);
+	if (token == nullptr)
+	{
+		Debug::log("Invalid set derived capability {}", sealedCap);
+		return -EPERM;
+	}
+
+	if (numInputs == 0 || numInputs > MaxDerivedConfigInputs ||
+	    !CHERI::check_pointer<CHERI::PermissionSet{
+	      CHERI::Permission::Load, CHERI::Permission::LoadStoreCapability}>(
+	      inputs, numInputs * sizeof(inputs[0])))
+	{
+		Debug::log("Invalid inputs for {}", token->Name);
+		return -EINVAL;
+	}
+
+	auto d = find_or_create_config(token->Name);
+	if (d == nullptr)
+	{
+		Debug::log("Failed to create item {}", token->Name);
+		return -ENOMEM;
+	}
+
+	// A derived item can't also have a parser, and can't be used as
+	// the input to another derived item.
+	if (d->parser != nullptr || d->derived != nullptr ||
+	    d->multiParser != nullptr || d->isOutput)
+	{
+		Debug::log("{} is already defined", token->Name);
+		return -EEXIST;
+	}
+	if (d->dependents != nullptr)
+	{
+		Debug::log("{} is already used as an input", token->Name);
+		return -EINVAL;
+	}
+
+	auto derived = new (std::nothrow) DerivedState();
+	if (derived == nullptr)
+	{
+		return -ENOMEM;
+	}
+	derived->compute   = compute;
+	derived->numInputs = numInputs;
+
+	// The caller must be allowed to read each of the inputs.  Keep
+	// them sorted by address to give a fixed lock order.
+	for (size_t i = 0; i < numInputs; i++)
+	{
+		auto inputToken = name_capability_unseal(inputs[i], CONFIG_READ);
+		auto input      = (inputToken == nullptr)
+		                    ? nullptr
+		                    : find_or_create_config(inputToken->Name);
+		if (input == nullptr || input == d || input->derived != nullptr ||
+		    input->multiParser != nullptr || input->compressed)
+		{
+			Debug::log("Invalid input {} for {}", inputs[i], token->Name);
+			delete derived;
+			return -EINVAL;
+		}
+
+		if (!insert_sorted(
+		      derived->inputs, derived->argIndex, i, input, i))
+		{
+			Debug::log("Duplicate input {} for {}", inputs[i], token->Name);
+			delete derived;
+			return -EINVAL;
+		}
+	}
+
+	// Allocate the entries for the inputs' lists of dependents before
+	// adding any of them, so a failure leaves the inputs unchanged
+	// (an input with dependents can't become compressed or the input
+	// to a multi-output parser).
+	Dependent *deps[MaxDerivedConfigInputs];
+	for (size_t i = 0; i < numInputs; i++)
+	{
+		deps[i] = new (std::nothrow) Dependent();
+		if (deps[i] == nullptr)
+		{
+			while (i > 0)
+			{
+				delete deps[--i];
+			}
+			delete derived;
+			return -ENOMEM;
+		}
+	}
+
+	for (size_t i = 0; i < numInputs; i++)
+	{
+		auto input = derived->inputs[i];
+		LockGuard g{input->lock};
+		deps[i]->item     = d;
+		deps[i]->next     = input->dependents;
+		input->dependents = deps[i];
+	}
+
+	d->size = token->size;
+	{
+		LockGuard g{d->lock};
+		d->derived = derived;
+	}
+
+	// Compute the initial value from whatever the inputs
+	// currently hold, reloading any that were released under
+	// memory pressure before they had a dependent.
+	for (size_t i = 0; i < numInputs; i++)
+	{
+		restore_value(derived->inputs[i]);
+	}
+	update_derived(d);
+
+	return 0;
+}
+
+/**
+ * Get the broker's statistics.
+ */
+int __cheri_compartment("config_broker")
+  get_config_broker_stats(ConfigBrokerStats *result)
+{
+	if (!CHERI::check_pointer<CHERI::PermissionSet{CHERI::Permission::Store}>(
+	      result))
+	{
+		return -EINVAL;
+	}
+
+	LockGuard g{lockStats};
+	*result               = stats;
+	result->heapRemaining = heap_quota_remaining(MALLOC_CAPABILITY);
 
 	return 0;
-}
\ No newline at end of file
+}
@@ -19,14 +19,30 @@ struct ConfigToken
 {
 	size_t     size;           // Size of the item
 	uint32_t   updateInterval; // Min interval in mS between updates
+	uint32_t   flags;          // ConfigFlags
+	uint32_t   maxInput;       // Max bytes passed to the parser, 0 if any
+	uint32_t   parseBudget;    // Cycles before a parse is discarded, 0 if none
 	const char Name[];         // Name of the configuration item
 };
 
+/**
+ * Flags that can be set in a parser capability.
+ */
+enum ConfigFlags : uint32_t
+{
+	/**
+	 * Hold the value compressed.  Consumers read it with
+	 * read_config_into() rather than through the data pointer.
+	 */
+	ConfigCompressed = 1,
+};
+
 struct ConfigName {
 	const char Name[];
 };
 
 typedef CHERI_SEALED(struct ConfigName *) ReadConfigCapability;
+typedef CHERI_SEALED(struct ConfigName *) ReadConfigPrefixCapability;
 typedef CHERI_SEALED(struct ConfigName *) WriteConfigCapability;
 typedef CHERI_SEALED(struct ConfigToken *) ConfigCapability;
 
@@ -48,6 +64,27 @@ typedef CHERI_SEALED(struct ConfigToken *) ConfigCapability;
 #define READ_CONFIG_CAPABILITY(name)                                           \
 	STATIC_SEALED_VALUE(__read_config_capability_##name)
 
+/**
+ * Macros to create and use a Sealed Capability to read all of the
+ * config items under a prefix.  Item names are treated as a hierarchy
+ * of segments separated by '/', so a prefix of "led" covers both
+ * "led/rgb" and "led/user" (but not "ledger").
+ */
+#define DEFINE_READ_CONFIG_PREFIX_CAPABILITY(name)                             \
+                                                                               \
+	DECLARE_AND_DEFINE_STATIC_SEALED_VALUE_EXPLICIT_TYPE(                      \
+	  struct {                                                                 \
+		  const char Name[sizeof(name)];                                       \
+	  },                                                                       \
+	  struct ConfigName,                                                       \
+	  config_broker,                                                           \
+	  ReadConfigPrefixKey,                                                     \
+	  __read_config_prefix_capability_##name,                                  \
+	  name);
+
+#define READ_CONFIG_PREFIX_CAPABILITY(name)                                    \
+	STATIC_SEALED_VALUE(__read_config_prefix_capability_##name)
+
 /**
  * Macros to create and use a Sealed Capability to write a config item
  */
@@ -70,25 +107,163 @@ typedef CHERI_SEALED(struct ConfigToken *) ConfigCapability;
  * Marcos to create and use a Sealed Capability to set the parser
  * and properties for a config item
  */
+#define DEFINE_PARSER_CONFIG_CAPABILITY_WITH_FLAGS(                            \
+  name, Size, UpdateInterval, Flags)                                           \
+	__DEFINE_PARSER_CONFIG_CAPABILITY(__parser_config_capability_##name,      \
+	                                  name,                                    \
+	                                  Size,                                    \
+	                                  UpdateInterval,                          \
+	                                  Flags,                                   \
+	                                  0,                                       \
+	                                  0)
+
 #define DEFINE_PARSER_CONFIG_CAPABILITY(name, Size, UpdateInterval)            \
+	__DEFINE_PARSER_CONFIG_CAPABILITY(                                         \
+	  __parser_config_capability_##name, name, Size, UpdateInterval, 0, 0, 0)
+
+/**
+ * Define a parser capability with limits for each parse: the
+ * largest input, in bytes, the broker will pass to the parser, and
+ * the cycles after which a parse is discarded.  Either can be 0 for
+ * no limit.  Only the input size bounds how long a parse can take;
+ * the cycles are a threshold checked once the parser has returned.
+ * See set_config() for how each is enforced.
+ */
+#define DEFINE_PARSER_CONFIG_CAPABILITY_WITH_BUDGET(                           \
+  name, Size, UpdateInterval, MaxInput, ParseBudget)                           \
+	__DEFINE_PARSER_CONFIG_CAPABILITY(__parser_config_capability_##name,      \
+	                                  name,                                    \
+	                                  Size,                                    \
+	                                  UpdateInterval,                          \
+	                                  0,                                       \
+	                                  MaxInput,                                \
+	                                  ParseBudget)
+
+/**
+ * Define a parser capability for a large item which the broker
+ * should hold compressed, such as a schedule or lookup table.
+ */
+#define DEFINE_COMPRESSED_PARSER_CONFIG_CAPABILITY(name, Size, UpdateInterval) \
+	__DEFINE_PARSER_CONFIG_CAPABILITY(__parser_config_capability_##name,      \
+	                                  name,                                    \
+	                                  Size,                                    \
+	                                  UpdateInterval,                          \
+	                                  ConfigCompressed,                        \
+	                                  0,                                       \
+	                                  0)
+
+/**
+ * Common part of the parser capability macros.  The symbol is pasted
+ * by each of the public macros so that name is not expanded first.
+ */
+#define __DEFINE_PARSER_CONFIG_CAPABILITY(                                     \
+  symbol, name, Size, UpdateInterval, Flags, MaxInput, ParseBudget)            \
                                                                                \
 	DECLARE_AND_DEFINE_STATIC_SEALED_VALUE_EXPLICIT_TYPE(                      \
 	  struct {                                                                 \
 		  size_t     size;                                                     \
 		  uint32_t   update_interval;                                          \
+		  uint32_t   flags;                                                    \
+		  uint32_t   max_input;                                                \
+		  uint32_t   parse_budget;                                             \
 		  const char Name[sizeof(name)];                                       \
 	  },                                                                       \
-	  struct ConfigToken,                                                        \
+	  struct ConfigToken,                                                      \
 	  config_broker,                                                           \
 	  ParserConfigKey,                                                         \
-	  __parser_config_capability_##name,                                       \
+	  symbol,                                                                  \
 	  Size,                                                                    \
 	  UpdateInterval,                                                          \
+	  Flags,                                                                   \
+	  MaxInput,                                                                \
+	  ParseBudget,                                                             \
 	  name);
 
 #define PARSER_CONFIG_CAPABILITY(name)                                         \
 	STATIC_SEALED_VALUE(__parser_config_capability_##name)
 
+/**
+ * Macros to define and use a build time default value for a config
+ * item.  The value is held in read only memory in the compartment that
+ * registers the parser, and is passed to set_parser().  For example:
+ *
+ *   DEFINE_CONFIG_DEFAULT(RGB_LED_CONFIG, rgbLed::Config, {{0, 0, 0}, {0, 0, 0}})
+ *   set_parser(PARSER_CONFIG_CAPABILITY(RGB_LED_CONFIG),
+ *              parse_RGB_LED_config,
+ *              CONFIG_DEFAULT(RGB_LED_CONFIG));
+ */
+#define DEFINE_CONFIG_DEFAULT(name, Type, ...)                                 \
+	static const Type __config_default_##name = __VA_ARGS__;
+
+#define CONFIG_DEFAULT(name) (&__config_default_##name)
+
+/**
+ * Macros to create and use a Sealed Capability to define a derived
+ * config item, whose value is computed by the broker from the values
+ * of other items rather than being set by a provider.
+ */
+#define DEFINE_DERIVED_CONFIG_CAPABILITY(name, Size)                           \
+                                                                               \
+	DECLARE_AND_DEFINE_STATIC_SEALED_VALUE_EXPLICIT_TYPE(                      \
+	  struct {                                                                 \
+		  size_t     size;                                                     \
+		  uint32_t   update_interval;                                          \
+		  uint32_t   flags;                                                    \
+		  uint32_t   max_input;                                                \
+		  uint32_t   parse_budget;                                             \
+		  const char Name[sizeof(name)];                                       \
+	  },                                                                       \
+	  struct ConfigToken,                                                      \
+	  config_broker,                                                           \
+	  DerivedConfigKey,                                                        \
+	  __derived_config_capability_##name,                                      \
+	  Size,                                                                    \
+	  0,                                                                       \
+	  0,                                                                       \
+	  0,                                                                       \
+	  0,                                                                       \
+	  name);
+
+#define DERIVED_CONFIG_CAPABILITY(name)                                        \
+	STATIC_SEALED_VALUE(__derived_config_capability_##name)
+
+/**
+ * Maximum number of inputs to a derived config item.
+ */
+static constexpr size_t MaxDerivedConfigInputs = 8;
+
+/**
+ * Maximum number of outputs from a multi-output parser.
+ */
+static constexpr size_t MaxParserOutputs = 8;
+
+/**
+ * Maximum number of message queues subscribed to a config item (see
+ * subscribe_config()), and of bitmaps watching it (see watch_config()).
+ * Each is allocated from the broker's heap, so the number that can be
+ * made through any one read capability is also limited, which stops
+ * a consumer from using up the broker's quota or every slot on an
+ * item.
+ */
+static constexpr size_t MaxConfigSubscriptions      = 8;
+static constexpr size_t MaxConfigWatches            = 8;
+static constexpr size_t MaxConfigListenersPerCaller = 2;
+
+/**
+ * Cycle counts (from rdcycle64()) at each stage of an update on its
+ * way from a provider to the consumers, or zero if not recorded.  The
+ * provider sets ingest and verified when it calls set_config(), and the
+ * broker sets the rest.  Derived items only have a commit time.
+ */
+struct ConfigTrace
+{
+	uint64_t ingest;     // Update received by the provider
+	uint64_t verified;   // Signature on the update verified
+	uint64_t parseStart; // Parser called
+	uint64_t parseEnd;   // Parser returned
+	uint64_t commit;     // New version published
+};
+
 /**
  * External view of a configuration item.
  */
@@ -98,15 +273,141 @@ struct ConfigItem
 	uint32_t               version;      // version
 	void                  *data;         // value
 	std::atomic<uint32_t> *versionFutex; // Futex to wait for version change
+	ConfigTrace            trace;        // How this version was set
+};
+
+/**
+ * Record posted to a subscriber's message queue when an item changes.
+ *
+ * data is only a hint: the broker frees the value when the item next
+ * changes (or releases it under memory pressure) whether or not the
+ * record has been received.  A consumer must claim it before use and,
+ * if the claim fails, read the item again with get_config().
+ */
+struct ConfigUpdate
+{
+	const char *name;    // name
+	uint32_t    id;      // id given by the subscriber
+	uint32_t    version; // version
+	const void *data;    // read only heap pointer to the value, or
+	                     // nullptr if the item is held compressed
+	uint32_t    dropped; // records discarded since the previous one
+	ConfigTrace trace;   // how this version was set
+};
+
+/**
+ * Flags for subscribe_config()
+ */
+enum ConfigSubscribeFlags : uint32_t
+{
+	/**
+	 * If the queue is full discard the oldest record to make space
+	 * for the new one, rather than discarding the new record.  The
+	 * queue then always holds the most recent changes.
+	 */
+	ConfigSubscribeCoalesce = 1,
+};
+
+struct MessageQueue;
+
+/**
+ * External view of a prefix, i.e. a subtree of configuration items.
+ */
+struct ConfigPrefix
+{
+	const char            *name;         // prefix
+	uint32_t               version;      // aggregate version of the subtree
+	std::atomic<uint32_t> *versionFutex; // Futex to wait for any change
+};
+
+/**
+ * Statistics on the broker's use of memory and locks.
+ *
+ * When the broker's remaining heap quota falls below a threshold it
+ * releases the values it can restore later (default values, and under
+ * critical pressure the cached values of derived items), and reloads
+ * them the next time they are read.  bytesReclaimed is the total size
+ * of the values released.  Consumers that have their own claim on a
+ * value keep it allocated until they release the claim.
+ *
+ * lockWaits counts the number of times a thread had to wait for the
+ * lock on an item, and lockWaitCycles the total time spent waiting.
+ *
+ * inputsTooLarge counts the updates rejected for being larger than
+ * the maxInput in an item's parser capability, and parseOverruns the
+ * parses that took longer than its parseBudget (whether or not the
+ * parser accepted the value).  maxParseCycles is the longest any
+ * parse has taken, which can be used to choose both limits.
+ */
+struct ConfigBrokerStats
+{
+	ssize_t  heapRemaining;   // Broker's remaining heap quota
+	uint32_t pressureEvents;  // Times memory has been released
+	uint32_t evictedDefaults; // Default values released
+	uint32_t evictedDerived;  // Derived values released
+	size_t   bytesReclaimed;  // Total size of the values released
+	uint32_t allocFailures;   // Allocations that still failed
+	uint32_t lockWaits;       // Contended item lock acquires
+	uint64_t lockWaitCycles;  // Cycles spent waiting for item locks
+	uint32_t inputsTooLarge;  // Updates larger than the item's maxInput
+	uint32_t parseOverruns;   // Parses that took longer than parseBudget
+	uint32_t maxParseCycles;  // Longest parse, in cycles
+};
+
+/**
+ * Diagnostics for the lock on a configuration item.  Times are in
+ * cycles, and saturate rather than wrap.
+ *
+ * The lock uses priority inheritance, so each time a thread waits
+ * it lends its priority to the holder, which is boosted if the
+ * waiter has the higher priority.  waits is therefore the number of
+ * times the holder may have been boosted.  The threads involved in
+ * the longest wait are recorded so they can be compared with the
+ * priorities in the firmware's thread table.
+ */
+struct ConfigLockStats
+{
+	uint32_t acquires;       // Times the lock has been taken
+	uint32_t waits;          // Times a thread had to wait (i.e. boosts)
+	uint32_t maxHoldCycles;  // Longest time the lock was held
+	uint32_t meanHoldCycles; // Mean time the lock was held
+	uint32_t maxWaitCycles;  // Longest time a thread waited
+	uint16_t maxWaitHolder;  // Thread holding the lock in the longest wait
+	uint16_t maxWaitWaiter;  // Thread that waited in the longest wait
 };
 
 /**
  * Set the value of a configuration item.
  *
- * Returns 0 for success.
+ * Returns 0 for success, or a negative error:
+ *   -EPERM      the capability is not valid
+ *   -ENODEV     no parser has been registered for the item
+ *   -EBUSY      the item was updated less than its interval ago
+ *   -EMSGSIZE   the value is larger than the parser's maxInput
+ *   -EINVAL     the parser rejected the value
+ *   -ETIMEDOUT  the parser accepted the value but took longer than
+ *               its parseBudget
+ *   -ENOMEM     the broker could not allocate space for the value
+ *
+ * Only the maxInput in the parser capability bounds the time an
+ * update can hold the provider's thread: the length is checked before
+ * the parser is called, and the parsers make a single pass over the
+ * value.  The parser runs to completion in its own compartment, so
+ * the parseBudget can't stop a parse early.  It is a threshold checked
+ * once the parser returns; a value which took longer to parse is
+ * discarded, even if it was valid, so that a provider can't rely on
+ * it.  The cycles include any time the thread was preempted, so the
+ * threshold should leave room for that.
+ *
+ * If trace is provided its ingest and verified times are kept with
+ * the new version, so the consumers can measure the latency of the
+ * whole path.
  */
 int __cheri_compartment("config_broker")
-  set_config(WriteConfigCapability configWriteCapability, const void *src, size_t srcLength);
+  set_config(WriteConfigCapability configWriteCapability,
+             const void           *src,
+             size_t                srcLength,
+             const ConfigTrace    *trace = nullptr);
 
 /**
  * Read the value of a configuration item.
@@ -117,16 +418,165 @@ int __cheri_compartment("config_broker")
  *   version      - the version returned in *data
  *   data         - a read only heap pointer the value.
  *                  May be null if the value has not yet been set.
+ *                  If the parser was registered with a default
+ *                  value this is served as version 0 until the
+ *                  first update.
+ *                  May also be null if a value released under
+ *                  memory pressure could not be reloaded, and is
+ *                  always null for an item held compressed (see
+ *                  read_config_into()).
  *                  The broker will free this allocation when the
  *                  value changes, so callers should make their own
  *                  claim on this.
  *   versionFutex - a pointer that can be used as a futex to wait
  *                  for version changes. This will be nullptr if
  *                  the caller does not have access to the item.
+ *   trace        - the times at which this version passed through
+ *                  each stage from the provider.
  */
 ConfigItem __cheri_compartment("config_broker")
   get_config(ReadConfigCapability configReadCapability);
 
+/**
+ * Copy the value of a configuration item into a caller provided buffer.
+ *
+ * Returns the size of the value on success, or a negative error:
+ *   -EPERM   the capability is not valid
+ *   -ENOENT  the item has no value
+ *   -EINVAL  the buffer is not writable or is smaller than the value
+ *
+ * If version is not nullptr it is set to the version copied.
+ *
+ * This is the only way to read an item whose parser capability has
+ * the ConfigCompressed flag, as the broker decompresses the value
+ * straight into the buffer.  It can also be used for any other item
+ * if the consumer would rather have its own copy than make a claim.
+ */
+int __cheri_compartment("config_broker")
+  read_config_into(ReadConfigCapability configReadCapability,
+                   void                *buffer,
+                   size_t               bufferLength,
+                   uint32_t            *version);
+
+/**
+ * Read the diagnostics for the lock on a configuration item, for
+ * example to find out if slow updates are caused by a consumer or
+ * parser holding the lock.
+ *
+ * Returns 0 on success, -EPERM if the capability is not valid or
+ * -EINVAL if stats is not writable.
+ */
+int __cheri_compartment("config_broker")
+  get_config_lock_stats(ReadConfigCapability configReadCapability,
+                        ConfigLockStats     *stats);
+
+/**
+ * Subscribe to changes in a configuration item via a message queue.
+ *
+ * Returns 0 on success
+ *
+ * queue is a handle created with queue_create_sealed() for elements of
+ * sizeof(ConfigUpdate).  Whenever the item changes the broker posts a
+ * ConfigUpdate with the new version and a read only pointer to the new
+ * value, so the consumer does not need to call get_config().  If the
+ * item already has a value it is posted immediately.  id is copied into
+ * each record so the subscriber can identify the item without comparing
+ * names.
+ *
+ * The broker never blocks the thread making the change.  If the queue
+ * is full the record is discarded (or with ConfigSubscribeCoalesce the
+ * oldest record is discarded) and the count of discarded records is
+ * carried in the next record that is posted.  A consumer that sees a
+ * non zero dropped count should call get_config() for its items.
+ *
+ * As with get_config() the broker will free the value when it changes,
+ * so consumers should make their own claim on it.  Calling subscribe
+ * again with the same queue updates the id and flags.
+ *
+ * Returns 0 on success, -EPERM if the capability is not valid, -EBUSY
+ * if the item already has MaxConfigSubscriptions queues or this
+ * capability has MaxConfigListenersPerCaller of them, -EINVAL if the
+ * current value could not be posted, or -ENOMEM.
+ */
+int __cheri_compartment("config_broker")
+  subscribe_config(ReadConfigCapability configReadCapability,
+                   CHERI_SEALED(struct MessageQueue *) queue,
+                   uint32_t id,
+                   uint32_t flags);
+
+/**
+ * Stop posting changes for a configuration item to a message queue.
+ *
+ * Returns 0 on success or -ENOENT if the queue was not subscribed.
+ */
+int __cheri_compartment("config_broker")
+  unsubscribe_config(ReadConfigCapability configReadCapability,
+                     CHERI_SEALED(struct MessageQueue *) queue);
+
+/**
+ * Watch for changes in a configuration item through a changed-item
+ * bitmap, so that a consumer can wait for changes to any number of
+ * items on a single futex.
+ *
+ * Returns 0 on success, -EPERM if the capability is not valid,
+ * -EINVAL if the bitmap is not writable global memory (the broker
+ * keeps a pointer to it, so it can't be on the stack) large enough
+ * to hold bit, -EBUSY if the item already has MaxConfigWatches
+ * bitmaps or this capability has MaxConfigListenersPerCaller of them,
+ * or -ENOMEM.
+ *
+ * Whenever the item changes the broker sets bit in changeBits (held
+ * in word bit / 32) and then increments the change sequence returned
+ * by get_config_change_sequence().  A consumer waits on the change
+ * sequence and each time it wakes exchanges the words of its bitmap
+ * with zero, which gives exactly the items it needs to read.  If the
+ * item already has a value the bit is set immediately.  Calling watch
+ * again with the same bitmap changes the bit.
+ */
+int __cheri_compartment("config_broker")
+  watch_config(ReadConfigCapability   configReadCapability,
+               std::atomic<uint32_t> *changeBits,
+               uint32_t               bit);
+
+/**
+ * Stop marking changes to a configuration item in a bitmap.
+ *
+ * Returns 0 on success or -ENOENT if the bitmap was not watching
+ * the item.
+ */
+int __cheri_compartment("config_broker")
+  unwatch_config(ReadConfigCapability   configReadCapability,
+                 std::atomic<uint32_t> *changeBits);
+
+/**
+ * Get a read only futex which the broker increments after setting
+ * the bits for a change to any watched item (see watch_config()).
+ */
+std::atomic<uint32_t> *__cheri_compartment("config_broker")
+  get_config_change_sequence();
+
+/**
+ * Read all of the configuration items under a prefix.
+ *
+ * Populates *prefix with the aggregate version of the subtree and a
+ * read only futex which is incremented whenever any item under the
+ * prefix changes, so a single wait covers the whole subtree.
+ *
+ * Up to maxItems entries of items are then populated, with the same
+ * properties as the value returned by get_config().  items may be
+ * nullptr if maxItems is zero, which just reads the prefix futex.
+ * The aggregate version is read before the items, so any change made
+ * during the call will be seen as a new version.
+ *
+ * Returns the number of items under the prefix, which may be more
+ * than maxItems, or a negative error code.
+ */
+int __cheri_compartment("config_broker")
+  get_config_prefix(ReadConfigPrefixCapability configReadPrefixCapability,
+                    ConfigPrefix                 *prefix,
+                    ConfigItem                   *items,
+                    size_t                        maxItems);
+
 /**
  * Set the parser for a configuration item.
  *
@@ -136,7 +586,78 @@ ConfigItem __cheri_compartment("config_broker")
  * change the value of a config item, and should be a callback
  * to a sandbox compartment as the data is not trusted at this
  * point.
+ *
+ * If defaultValue is provided it must point to a value of the size
+ * given in the capability, typically defined with
+ * DEFINE_CONFIG_DEFAULT.  If the item has not yet been set the broker
+ * takes a copy and serves it to consumers as version 0, so they
+ * have a valid value from the point the parser registers.  The first
+ * update from a provider replaces it as version 1.
  */
 int __cheri_compartment("config_broker")
   set_parser(ConfigCapability configValidateCapability,
-             __cheri_callback int parse(const void *src, void *dst));
+             __cheri_callback int parse(const void *src, void *dst),
+             const void          *defaultValue = nullptr);
+
+/**
+ * Set a parser which populates several configuration items from a
+ * single document.
+ *
+ * Returns 0 on success
+ *
+ * input is the capability for the item that providers set (with a
+ * size of zero, as it holds no value of its own) and defines the
+ * minimum interval between updates.  outputs are the capabilities
+ * for each item the parser populates, which give the size of each
+ * value; their update intervals are ignored, so the input's interval
+ * limits how often all of them can change.  An output can also have
+ * a parser of its own (set with set_parser()), provided both
+ * capabilities give it the same size and flags.
+ *
+ * When a provider sets the input item the parser is called once with
+ * a write only pointer to a new value for each output, in the same
+ * order as outputs.  If it succeeds all of the outputs are committed
+ * together, so a consumer reading any of them after being woken will
+ * see the new value of every output.  If it fails none of them change.
+ */
+int __cheri_compartment("config_broker")
+  set_multi_parser(ConfigCapability     input,
+                   ConfigCapability    *outputs,
+                   size_t               numOutputs,
+                   __cheri_callback int parse(const void *src,
+                                              void       *dst[],
+                                              size_t      numDst));
+
+/**
+ * Define a derived configuration item.
+ *
+ * Returns 0 on success
+ *
+ * The caller must have a read capability for each of the inputs.
+ * Whenever the version of any input changes the broker calls compute
+ * with read only pointers to the current value of each input (in the
+ * same order as inputs, and nullptr if an input has not yet been set)
+ * and a write only pointer to a new value of the size given in the
+ * derived capability.  If compute returns 0 the new value is published
+ * as a new version of the derived item in the same way as a value
+ * from a provider.
+ *
+ * compute is only called when an input has changed, and its result is
+ * shared by all consumers of the derived item.  As with a parser it
+ * should be a callback to a sandbox compartment.
+ */
+int __cheri_compartment("config_broker")
+  set_derived(ConfigCapability      configDerivedCapability,
+              ReadConfigCapability *inputs,
+              size_t                numInputs,
+              __cheri_callback int  compute(const void *inputs[],
+                                           size_t      numInputs,
+                                           void       *dst));
+
+/**
+ * Read the broker's memory and lock statistics.
+ *
+ * Returns 0 on success or -EINVAL if stats is not writable.
+ */
+int __cheri_compartment("config_broker")
+  get_config_broker_stats(ConfigBrokerStats *stats);
@@ -0,0 +1,249 @@
+// Copyright Configured Things Ltd and CHERIoT Contributors.
+// SPDX-License-Identifier: MIT
+
+#include <string.h>
+
+#include "lz.h"
+
+namespace
+{
+	/// Shortest match worth encoding.
+	constexpr size_t MinMatch = 4;
+
+	/// Furthest we can look back with a two byte offset.
+	constexpr size_t MaxOffset = 0xffff;
+
+	/// Size of the hash table used to find matches.
+	constexpr size_t HashBits = 7;
+
+	uint32_t read32(const uint8_t *p)
+	{
+		uint32_t v;
+		memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	size_t hash(uint32_t v)
+	{
+		return (v * 2654435761U) >> (32 - HashBits);
+	}
+
+	/**
+	 * Write a length that didn't fit in a nibble as a run of 255s
+	 * followed by the remainder.  Returns false if it won't fit.
+	 */
+	bool write_length(uint8_t *dst, size_t dstLength, size_t &op, size_t len)
+	{
+		while (len >= 255)
+		{
+			if (op >= dstLength)
+			{
+				return false;
+			}
+			dst[op++] = 255;
+			len -= 255;
+		}
+		if (op >= dstLength)
+		{
+			return false;
+		}
+		dst[op++] = len;
+		return true;
+	}
+
+	/**
+	 * Read a length that didn't fit in a nibble.  Returns false if
+	 * the input runs out.
+	 */
+	bool
+	read_length(const uint8_t *src, size_t srcLength, size_t &ip, size_t &len)
+	{
+		uint8_t b;
+		do
+		{
+			if (ip >= srcLength)
+			{
+				return false;
+			}
+			b = src[ip++];
+			len += b;
+		} while (b == 255);
+		return true;
+	}
+
+	/**
+	 * Write a block of literals followed (if matchLength is not zero)
+	 * by a match.  Returns false if it won't fit.
+	 */
+	bool write_block(const uint8_t *literals,
+	                 size_t         literalLength,
+	                 size_t         offset,
+	                 size_t         matchLength,
+	                 uint8_t       *dst,
+	                 size_t         dstLength,
+	                 size_t        &op)
+	{
+		size_t matchCode = (matchLength > 0) ? matchLength - MinMatch : 0;
+
+		if (op >= dstLength)
+		{
+			return false;
+		}
+		dst[op++] = ((literalLength < 15 ? literalLength : 15) << 4) |
+		            (matchCode < 15 ? matchCode : 15);
+
+		if (literalLength >= 15 &&
+		    !write_length(dst, dstLength, op, literalLength - 15))
+		{
+			return false;
+		}
+
+		if (literalLength > dstLength - op)
+		{
+			return false;
+		}
+		memcpy(&dst[op], literals, literalLength);
+		op += literalLength;
+
+		if (matchLength == 0)
+		{
+			return true;
+		}
+
+		if (dstLength - op < 2)
+		{
+			return false;
+		}
+		dst[op++] = offset & 0xff;
+		dst[op++] = offset >> 8;
+
+		return (matchCode < 15) ||
+		       write_length(dst, dstLength, op, matchCode - 15);
+	}
+} // namespace
+
+size_t lz_compress(const uint8_t *src,
+                   size_t         srcLength,
+                   uint8_t       *dst,
+                   size_t         dstLength)
+{
+	// Positions in the hash table are only 16 bits
+	if (srcLength >= MaxOffset)
+	{
+		return 0;
+	}
+
+	// Positions are stored plus one so that zero means empty
+	uint16_t table[1 << HashBits] = {};
+
+	size_t ip     = 0;
+	size_t anchor = 0;
+	size_t op     = 0;
+
+	while (srcLength >= MinMatch && ip <= srcLength - MinMatch)
+	{
+		uint32_t seq  = read32(&src[ip]);
+		size_t   h    = hash(seq);
+		size_t   cand = table[h];
+		table[h]      = ip + 1;
+
+		if (cand == 0 || ip - (cand - 1) > MaxOffset ||
+		    read32(&src[cand - 1]) != seq)
+		{
+			ip++;
+			continue;
+		}
+		cand--;
+
+		size_t matchLength = MinMatch;
+		while (ip + matchLength < srcLength &&
+		       src[cand + matchLength] == src[ip + matchLength])
+		{
+			matchLength++;
+		}
+
+		if (!write_block(&src[anchor],
+		                 ip - anchor,
+		                 ip - cand,
+		                 matchLength,
+		                 dst,
+		                 dstLength,
+		                 op))
+		{
+			return 0;
+		}
+
+		ip += matchLength;
+		anchor = ip;
+	}
+
+	if (!write_block(
+	      &src[anchor], srcLength - anchor, 0, 0, dst, dstLength, op))
+	{
+		return 0;
+	}
+
+	return op;
+}
+
+ssize_t lz_decompress(const uint8_t *src,
+                      size_t         srcLength,
+                      uint8_t       *dst,
+                      size_t         dstLength)
+{
+	size_t ip = 0;
+	size_t op = 0;
+
+	while (ip < srcLength)
+	{
+		uint8_t token = src[ip++];
+
+		size_t literalLength = token >> 4;
+		if (literalLength == 15 &&
+		    !read_length(src, srcLength, ip, literalLength))
+		{
+			return -1;
+		}
+		if (literalLength > srcLength - ip || literalLength > dstLength - op)
+		{
+			return -1;
+		}
+		memcpy(&dst[op], &src[ip], literalLength);
+		ip += literalLength;
+		op += literalLength;
+
+		// The last block has no match
+		if (ip == srcLength)
+		{
+			break;
+		}
+
+		if (srcLength - ip < 2)
+		{
+			return -1;
+		}
+		size_t offset = src[ip] | (src[ip + 1] << 8);
+		ip += 2;
+
+		size_t matchLength = token & 0xf;
+		if (matchLength == 15 &&
+		    !read_length(src, srcLength, ip, matchLength))
+		{
+			return -1;
+		}
+		matchLength += MinMatch;
+
+		if (offset == 0 || offset > op || matchLength > dstLength - op)
+		{
+			return -1;
+		}
+
+		// Matches can overlap the output, so copy a byte at a time
+		for (size_t i = 0; i < matchLength; i++, op++)
+		{
+			dst[op] = dst[op - offset];
+		}
+	}
+
+	return op;
+}
@@ -0,0 +1,42 @@
+// Copyright Configured Things Ltd and CHERIoT Contributors.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/**
+ * A small LZ77 codec used by the config broker to hold large values
+ * compressed.  The format is a sequence of LZ4 style blocks, each made
+ * up of a token byte (literal count in the high nibble, match length - 4
+ * in the low nibble, with 15 in either meaning more length bytes
+ * follow), the literals, and a two byte little endian offset back to
+ * the match.  The final block has only literals.
+ *
+ * The compressor uses a small hash table on the stack rather than any
+ * heap, and only looks back as far as the last match for each hash,
+ * which is enough for the repetitive tables and schedules it is
+ * intended for.
+ */
+
+/**
+ * Compress srcLength bytes from src into dst.  Returns the compressed
+ * length, or 0 if it would not fit in dstLength bytes (i.e. the value
+ * is not worth compressing) or srcLength is 64KiB or more.
+ */
+size_t lz_compress(const uint8_t *src,
+                   size_t         srcLength,
+                   uint8_t       *dst,
+                   size_t         dstLength);
+
+/**
+ * Decompress srcLength bytes from src into dst.  Returns the
+ * decompressed length, or -1 if the data is malformed or would
+ * overflow dstLength bytes.
+ */
+ssize_t lz_decompress(const uint8_t *src,
+                      size_t         srcLength,
+                      uint8_t       *dst,
+                      size_t         dstLength);
@@ -1,9 +1,29 @@
 --Copyright Configured Things Ltd and CHERIoT Contributors.
 --SPDX - License -Identifier : MIT
 
+option("broker-heap-low")
+    set_default("1024")
+    set_description("Heap quota below which the config broker releases default values")
+
+option("broker-heap-critical")
+    set_default("256")
+    set_description("Heap quota below which the config broker also releases derived values")
+
+option("broker-compress-max")
+    set_default("1024")
+    set_description("Largest compressed value the config broker will hold")
+
 -- Configuration Broker 
 debugOption("config_broker")
 compartment("config_broker")
     set_default(false)
     add_rules("cheriot.component-debug")
-    add_files("config_broker.cc")
+    add_deps("message_queue")
+    add_files("config_broker.cc", "lz.cc")
+
+    on_load(function(target)
+        target:add('options', "broker-heap-low", "broker-heap-critical", "broker-compress-max")
+        target:add("defines", "CONFIG_BROKER_HEAP_LOW=" .. tostring(get_config("broker-heap-low")))
+        target:add("defines", "CONFIG_BROKER_HEAP_CRITICAL=" .. tostring(get_config("broker-heap-critical")))
+        target:add("defines", "CONFIG_BROKER_COMPRESS_MAX=" .. tostring(get_config("broker-compress-max")))
+    end)
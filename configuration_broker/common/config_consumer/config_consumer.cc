@@ -5,7 +5,10 @@
 #include <cstdint>
 #include <cstdlib>
 #include <debug.hh>
+#include <futex.h>
 #include <multiwaiter.h>
+#include <queue.h>
+#include <riscvreg.h>
 #include <thread.h>
 #include <token.h>
 
@@ -18,40 +21,362 @@ using Debug = ConditionalDebug<false, "ConfigConsumer">;
 namespace ConfigConsumer
 {
 
+	namespace
+	{
+
+		uint64_t ticks_now()
+		{
+			auto tick = thread_systemtick_get();
+			return (static_cast<uint64_t>(tick.hi) << 32) + tick.lo;
+		}
+
+		/**
+		 * Add the times taken by an update to an item's latency
+		 * histograms.  If the provider didn't record when it received
+		 * the update the total is from when the broker committed it.
+		 */
+		void record_latency(Latency           *latency,
+		                    const ConfigTrace &trace,
+		                    uint64_t           wokeAt,
+		                    uint64_t           handled)
+		{
+			auto start = (trace.ingest != 0) ? trace.ingest : trace.commit;
+
+			// A change committed after we woke was seen on the same read
+			if (wokeAt < trace.commit)
+			{
+				wokeAt = trace.commit;
+			}
+
+			latency->last        = trace;
+			latency->lastWake    = wokeAt;
+			latency->lastHandled = handled;
+			latency->total.record(handled - start);
+			latency->wake.record(wokeAt - trace.commit);
+			latency->handler.record(handled - wokeAt);
+			if (trace.ingest != 0)
+			{
+				latency->broker.record(trace.commit - trace.ingest);
+			}
+		}
+
+		/**
+		 * Claim a new value and pass it to the item's handler,
+		 * recording if the handler exceeds its cycle budget or
+		 * completes after the item's deadline.  changedAt is the
+		 * system tick and wokeAt the cycle count at which the change
+		 * was seen, and trace the times recorded by the provider and
+		 * broker.  Returns false if the value could not be claimed,
+		 * i.e. it has already been freed by the broker.
+		 */
+		bool call_handler(ConfigItem        *c,
+		                  const char        *name,
+		                  const void        *data,
+		                  uint64_t           changedAt,
+		                  const ConfigTrace &trace,
+		                  uint64_t           wokeAt)
+		{
+			// Make a fast claim on the data now, the handler
+			// can decide if it wants to make a full claim
+			Timeout t{5000};
+			int     claimed = heap_claim_ephemeral(&t, data, nullptr);
+			if (claimed != 0)
+			{
+				Debug::log("thread {} failed fast claim for {} {} with {}",
+				           thread_id_get(),
+				           name,
+				           data,
+				           claimed);
+				return false;
+			}
+
+			if (c->replica != nullptr &&
+			    c->replica->update(data, c->version) != 0)
+			{
+				Debug::log("thread {} value of {} too small for replica",
+				           thread_id_get(),
+				           name);
+				return true;
+			}
+
+			if (c->handler == nullptr)
+			{
+				if (c->latency != nullptr)
+				{
+					record_latency(c->latency, trace, wokeAt, rdcycle64());
+				}
+				return true;
+			}
+
+			Debug::log("Calling handler for {}", name);
+			auto start = rdcycle64();
+			if (c->handler(const_cast<void *>(data)) != 0)
+			{
+				Debug::log("thread {} handler failed for {} {}",
+				           thread_id_get(),
+				           name,
+				           data);
+			}
+			auto end    = rdcycle64();
+			auto cycles = end - start;
+
+			if (c->latency != nullptr)
+			{
+				record_latency(c->latency, trace, wokeAt, end);
+			}
+
+			if (cycles > c->maxHandlerCycles)
+			{
+				c->maxHandlerCycles = (cycles > UINT32_MAX) ? UINT32_MAX : cycles;
+			}
+			if (c->budgetCycles > 0 && cycles > c->budgetCycles)
+			{
+				c->overBudget++;
+				Debug::log("Handler for {} took {} cycles", name, cycles);
+			}
+			if (c->deadlineMs > 0 &&
+			    (ticks_now() - changedAt) * MS_PER_TICK > c->deadlineMs)
+			{
+				c->missedDeadlines++;
+				Debug::log("Handler for {} missed its deadline", name);
+			}
+			return true;
+		}
+
+		/**
+		 * Read the current value of an item directly from the broker
+		 * and pass it to the handler if it has changed (or always, if
+		 * force is set).  Used by the push mode to recover when records
+		 * have been discarded, or when the value in a record has been
+		 * freed before the record was received.
+		 */
+		void resync(ConfigItem *c, bool force = false)
+		{
+			auto item = get_config(c->capability);
+			// Version 0 may be a default value we never received
+			if (item.versionFutex == nullptr || item.data == nullptr ||
+			    (!force && item.version == c->version && item.version != 0))
+			{
+				return;
+			}
+
+			c->version      = item.version;
+			c->versionFutex = item.versionFutex;
+			call_handler(
+			  c, item.name, item.data, ticks_now(), item.trace, rdcycle64());
+		}
+
+	} // namespace
+
 	/**
 	 * Thread entry point.  The waits for changes to one
 	 * or more configuration values and then calls the
 	 * appropriate handler.
 	 */
-	void __cheri_libcall run(ConfigItem configItems[],
-	                         size_t     numOfItems,
-	                         uint16_t   maxTimeouts)
+	void __cheri_libcall run(ConfigItem        configItems[],
+	                         size_t            numOfItems,
+	                         const RunOptions &options)
 	{
+		auto maxTimeouts = options.maxTimeouts;
+		auto multiwaiter = options.multiwaiter;
+
+		// Work out which items this thread is handling, highest
+		// priority first so that checking for a higher priority change
+		// only has to look at the start of the list.
+		ConfigItem *items[numOfItems];
+		size_t      numInLane = 0;
+		for (size_t i = 0; i < numOfItems; i++)
+		{
+			if (options.lane < 0 || configItems[i].lane == options.lane)
+			{
+				size_t n = numInLane++;
+				for (; n > 0 && items[n - 1]->priority < configItems[i].priority;
+				     n--)
+				{
+					items[n] = items[n - 1];
+				}
+				items[n] = &configItems[i];
+			}
+		}
+		if (numInLane == 0)
+		{
+			Debug::log("thread {} has no items in lane {}",
+			           thread_id_get(),
+			           options.lane);
+			return;
+		}
+		numOfItems = numInLane;
+
 		// Just for the demo keep track of the number to timeouts to give
 		// a clean exit
 		uint16_t num_timeouts = 0;
 
-		// Create the multi waiter
-		MultiWaiter mw = nullptr;
-		Timeout             t1{MS_TO_TICKS(1000)};
-		multiwaiter_create(&t1, MALLOC_CAPABILITY, &mw, numOfItems);
-		if (mw == nullptr)
+		// If the caller has given us a bitmap ask the broker to mark the
+		// items in it as they change, and wait on its change sequence.
+		auto changeBits     = options.changeBits;
+		auto changeSequence = (changeBits != nullptr)
+		                        ? get_config_change_sequence()
+		                        : nullptr;
+		uint32_t sequence   = 0;
+		if (changeBits != nullptr)
 		{
-			Debug::log("thread {} failed to create multiwaiter",
-			           thread_id_get());
-			return;
+			sequence = changeSequence->load();
+			for (size_t w = 0; w < (numOfItems + 31) / 32; w++)
+			{
+				changeBits[w] = 0;
+			}
+			for (size_t i = 0; i < numOfItems; i++)
+			{
+				if (watch_config(items[i]->capability, changeBits, i) != 0)
+				{
+					Debug::log("thread {} failed to watch {}",
+					           thread_id_get(),
+					           items[i]->capability);
+				}
+			}
 		}
 
-		// Create a set of wait events
+		// Use the caller's multi waiter if they have one, so that it
+		// survives if we are unwound and called again.  Otherwise
+		// create one just for this call.
+		MultiWaiter mw = (multiwaiter != nullptr) ? *multiwaiter : nullptr;
+		if (mw == nullptr && changeBits == nullptr)
+		{
+			Timeout t1{MS_TO_TICKS(1000)};
+			multiwaiter_create(&t1, MALLOC_CAPABILITY, &mw, numOfItems);
+			if (mw == nullptr)
+			{
+				Debug::log("thread {} failed to create multiwaiter",
+				           thread_id_get());
+				return;
+			}
+			if (multiwaiter != nullptr)
+			{
+				*multiwaiter = mw;
+			}
+		}
+
+		// Create a set of wait events, which are armed as each
+		// item is read.
 		struct EventWaiterSource events[numOfItems];
 
-		// We need to do an initial read of each item to at
-		// least get the version futex to wait on (there may not
-		// be a value yet. So set up the initial value of the
-		// events as if each item has been updated.
-		for (auto i = 0; i < numOfItems; i++)
+		// Items to read on this pass.
+		size_t   changed[numOfItems];
+		bool     pending[numOfItems];
+		uint64_t changedAt[numOfItems]; // System tick the change was seen
+		uint64_t wokeAt[numOfItems];    // Cycle count the change was seen
+		size_t   numChanged = 0;
+
+		// Add an item to the list of changed items
+		auto mark = [&](size_t i) {
+			pending[i]            = true;
+			changedAt[i]          = ticks_now();
+			wokeAt[i]             = rdcycle64();
+			changed[numChanged++] = i;
+		};
+
+		// The wait replaces the value of each event with whether it
+		// fired, so add any that did to the list of changed items and
+		// put back the expected version of each event.  For an item
+		// that has changed but not yet been read that is its current
+		// version, so we only wake again for a further change.
+		//
+		// As the multiwaiter overwrites every event this has to visit
+		// each of them; a consumer with enough items for that to matter
+		// should give us a bitmap, where a wake costs a word per 32
+		// items.
+		auto collect = [&](bool fired) {
+			for (size_t i = 0; i < numOfItems; i++)
+			{
+				auto c = items[i];
+				if (fired && events[i].value == 1 && !pending[i])
+				{
+					mark(i);
+				}
+				events[i].value = (pending[i] && c->versionFutex != nullptr)
+				                    ? c->versionFutex->load()
+				                    : c->version;
+			}
+		};
+
+		// Add the items marked in the bitmap, clearing their bits.
+		auto take_bits = [&]() {
+			for (size_t w = 0; w < (numOfItems + 31) / 32; w++)
+			{
+				uint32_t bits = changeBits[w].exchange(0);
+				for (size_t b = 0; bits != 0; b++, bits >>= 1)
+				{
+					size_t i = w * 32 + b;
+					if ((bits & 1) && i < numOfItems && !pending[i])
+					{
+						mark(i);
+					}
+				}
+			}
+		};
+
+		// Wait on the change sequence, and then pick up any of our
+		// items that have been marked.
+		auto wait_bits = [&](Timeout *t) {
+			futex_timed_wait(
+			  t, reinterpret_cast<const uint32_t *>(changeSequence), sequence);
+			sequence = changeSequence->load();
+			take_bits();
+		};
+
+		// Find the position in changed of the item to handle next,
+		// i.e. the first of those with the highest priority.
+		auto next_changed = [&]() {
+			size_t next = 0;
+			for (size_t n = 1; n < numChanged; n++)
+			{
+				if (items[changed[n]]->priority >
+				    items[changed[next]]->priority)
+				{
+					next = n;
+				}
+			}
+			return next;
+		};
+
+		// Add any items with a higher priority than above that have
+		// changed since they were last read, without waiting, by
+		// checking their version futex.  Items are sorted by priority
+		// so this stops at the first that isn't higher.
+		auto poll = [&](uint8_t above) {
+			if (changeBits != nullptr)
+			{
+				take_bits();
+				return;
+			}
+			for (size_t i = 0; i < numOfItems && items[i]->priority > above;
+			     i++)
+			{
+				auto c = items[i];
+				if (!pending[i] && c->versionFutex != nullptr &&
+				    c->versionFutex->load() != c->version)
+				{
+					mark(i);
+				}
+			}
+		};
+
+		// We need to do an initial read of each item to at least get
+		// the version futex to wait on (there may not be a value yet),
+		// so start as if every item has changed.  With a bitmap the
+		// broker has already marked each item that has a value, and
+		// there is nothing to wait on, so just take those; marking them
+		// here as well would call their handlers twice.
+		if (changeBits != nullptr)
 		{
-			events[i] = {nullptr, 1};
+			take_bits();
+		}
+		else
+		{
+			for (size_t i = 0; i < numOfItems; i++)
+			{
+				mark(i);
+			}
 		}
 
 		// Loop waiting for config changes.  The flow in here
@@ -59,77 +384,202 @@ namespace ConfigConsumer
 		// need for an initial read.
 		while (true)
 		{
-			// find out which value changed
-			for (auto i = 0; i < numOfItems; i++)
+			// Read and re-arm just the items that changed, highest
+			// priority first.  Items of equal priority are handled
+			// in the order their changes were seen.
+			while (numChanged > 0)
 			{
-				if (events[i].value == 1)
+				auto next = next_changed();
+				auto i    = changed[next];
+				for (size_t n = next + 1; n < numChanged; n++)
 				{
-					Debug::log("Item {} of {} changed", i, numOfItems);
+					changed[n - 1] = changed[n];
+				}
+				numChanged--;
+				pending[i] = false;
+				Debug::log("Item {} of {} changed", i, numOfItems);
 
-					auto c    = &configItems[i];
-					auto item = get_config(c->capability);
+				auto c    = items[i];
+				auto item = get_config(c->capability);
 
-					if (item.versionFutex == nullptr)
-					{
-						Debug::log("thread {} failed to get {}",
-						           thread_id_get(),
-						           c->capability);
-						continue;
-					}
+				if (item.versionFutex == nullptr)
+				{
+					Debug::log("thread {} failed to get {}",
+					           thread_id_get(),
+					           c->capability);
+					events[i] = {c->versionFutex, c->version};
+					continue;
+				}
 
-					c->version      = item.version;
-					c->versionFutex = item.versionFutex;
+				// A watched item can be marked again after we have read
+				// the version that marked it.
+				if (changeBits != nullptr && c->versionFutex != nullptr &&
+				    item.version == c->version && item.version != 0)
+				{
+					continue;
+				}
 
-					Debug::log("thread {} got version:{} of {}",
-					           thread_id_get(),
-					           c->version,
-					           item.name);
+				c->version      = item.version;
+				c->versionFutex = item.versionFutex;
+				events[i]       = {c->versionFutex, c->version};
 
-					if (item.data == nullptr)
-					{
-						Debug::log("No data yet for {}", item.name);
-						continue;
-					}
+				Debug::log("thread {} got version:{} of {}",
+				           thread_id_get(),
+				           c->version,
+				           item.name);
 
-					// Make a fast claim on the data now, the handler
-					// can decide if it wants to make a full claim
-					Timeout t{5000};
-					int     claimed = heap_claim_ephemeral(&t, item.data, nullptr);
-					if (claimed != 0)
+				if (item.data == nullptr)
+				{
+					Debug::log("No data yet for {}", item.name);
+					continue;
+				}
+
+				// Call the handler for this item
+				call_handler(c,
+				             item.name,
+				             item.data,
+				             changedAt[i],
+				             item.trace,
+				             wokeAt[i]);
+				Debug::log("After handler for {}", item.name);
+
+				// A higher priority item may have changed while the
+				// handler was running, so pick it up before any lower
+				// priority items that are still waiting.  If there are
+				// none the next wait will return at once for any change.
+				if (numChanged > 0)
+				{
+					poll(items[changed[next_changed()]]->priority);
+				}
+			}
+
+			// Wait for a version to change
+			Debug::log("Waiting for new events");
+			Timeout t{MS_TO_TICKS(10000)};
+			int     res;
+			if (changeBits != nullptr)
+			{
+				// The change sequence covers every watched item, so keep
+				// waiting until one of ours is marked.
+				while (numChanged == 0 && t.may_block())
+				{
+					wait_bits(&t);
+				}
+				res = (numChanged > 0) ? 0 : -ETIMEDOUT;
+			}
+			else
+			{
+				res        = multiwaiter_wait(&t, mw, events, numOfItems);
+				numChanged = 0;
+				collect(res == 0);
+			}
+
+			// Give the provider a chance to finish a burst of updates
+			// so that each handler is only called once.
+			if (res == 0 && options.coalesceMs > 0)
+			{
+				Timeout window{MS_TO_TICKS(options.coalesceMs)};
+				if (changeBits != nullptr)
+				{
+					while (window.may_block())
 					{
-						Debug::log(
-						  "thread {} failed fast claim for {} {} with {}",
-						  thread_id_get(),
-						  item.name,
-						  item.data,
-						  claimed);
-						continue;
+						wait_bits(&window);
 					}
-
-					// Call the handler for this item
-					Debug::log("Calling handler for {}", item.name);
-					if (c->handler(item.data) != 0)
+				}
+				else
+				{
+					while (window.may_block() &&
+					       multiwaiter_wait(&window, mw, events, numOfItems) ==
+					         0)
 					{
-						Debug::log("thread {} handler failed for {} {}",
-						           thread_id_get(),
-						           item.name,
-						           item.data);
+						collect(true);
 					}
-					Debug::log("After handler for {}", item.name);
+					collect(false);
 				}
+				Debug::log("{} items changed in coalescing window", numChanged);
 			}
 
-			// Reset the event waiter
-			for (auto i = 0; i < numOfItems; i++)
+			if (res != 0)
+			{
+				num_timeouts++;
+				Debug::log(
+				  "thread {} wait timeout {}", thread_id_get(), num_timeouts);
+				// For the demo exit the thread when we stop getting updates
+				if (maxTimeouts > 0 && num_timeouts >= maxTimeouts)
+				{
+					break;
+				}
+			}
+			else
 			{
-				events[i] = {configItems[i].versionFutex,
-				             configItems[i].version};
+				num_timeouts = 0;
 			}
+		}
 
-			// Wait for a version to change
-			Debug::log("Waiting for new events");
-			Timeout t{MS_TO_TICKS(10000)};
-			if (multiwaiter_wait(&t, mw, events, numOfItems) != 0)
+		if (changeBits != nullptr)
+		{
+			for (size_t i = 0; i < numOfItems; i++)
+			{
+				unwatch_config(items[i]->capability, changeBits);
+			}
+		}
+		else if (multiwaiter == nullptr)
+		{
+			multiwaiter_delete(MALLOC_CAPABILITY, mw);
+		}
+	}
+
+	/**
+	 * Thread entry point for push mode.  The broker posts each change,
+	 * including the new value, to a message queue so this thread only
+	 * needs to call into the broker to set up the subscriptions (and to
+	 * recover if the queue overflows).
+	 */
+	void __cheri_libcall run_push(ConfigItem configItems[],
+	                              size_t     numOfItems,
+	                              size_t     queueLength,
+	                              bool       coalesce,
+	                              uint16_t   maxTimeouts)
+	{
+		uint16_t num_timeouts = 0;
+
+		CHERI_SEALED(struct MessageQueue *) queue;
+		Timeout t1{MS_TO_TICKS(1000)};
+		if (queue_create_sealed(&t1,
+		                        MALLOC_CAPABILITY,
+		                        &queue,
+		                        sizeof(ConfigUpdate),
+		                        queueLength) != 0)
+		{
+			Debug::log("thread {} failed to create queue", thread_id_get());
+			return;
+		}
+
+		// Subscribe to each item, using its index as the id.  The broker
+		// posts the current value of any item that has already been set.
+		uint32_t flags = coalesce ? ConfigSubscribeCoalesce : 0;
+		for (size_t i = 0; i < numOfItems; i++)
+		{
+			configItems[i].version      = 0;
+			configItems[i].versionFutex = nullptr;
+			if (subscribe_config(configItems[i].capability, queue, i, flags) !=
+			    0)
+			{
+				Debug::log("thread {} failed to subscribe to {}",
+				           thread_id_get(),
+				           configItems[i].capability);
+			}
+		}
+
+		// Latest record for each item when coalescing
+		ConfigUpdate latest[numOfItems];
+		bool         pending[numOfItems];
+
+		while (true)
+		{
+			ConfigUpdate update;
+			Timeout      t{MS_TO_TICKS(10000)};
+			if (queue_receive_sealed(&t, queue, &update) != 0)
 			{
 				num_timeouts++;
 				Debug::log(
@@ -139,12 +589,97 @@ namespace ConfigConsumer
 				{
 					break;
 				}
+				continue;
 			}
-			else
+			num_timeouts = 0;
+
+			for (size_t i = 0; i < numOfItems; i++)
 			{
-				num_timeouts = 0;
+				pending[i] = false;
+			}
+
+			// Collect this record and, if coalescing, any others already
+			// in the queue so each handler is called once with the latest
+			// value.
+			bool resyncNeeded = false;
+			bool more         = true;
+			while (more)
+			{
+				resyncNeeded |= (update.dropped > 0);
+				if (update.id < numOfItems)
+				{
+					latest[update.id]  = update;
+					pending[update.id] = true;
+				}
+
+				more = false;
+				if (coalesce)
+				{
+					Timeout t0{0};
+					more = (queue_receive_sealed(&t0, queue, &update) == 0);
+				}
+			}
+
+			// Call the handlers highest priority first
+			auto receivedAt = ticks_now();
+			auto wokeAt     = rdcycle64();
+			while (true)
+			{
+				size_t i = numOfItems;
+				for (size_t j = 0; j < numOfItems; j++)
+				{
+					if (pending[j] &&
+					    (i == numOfItems ||
+					     configItems[j].priority > configItems[i].priority))
+					{
+						i = j;
+					}
+				}
+				if (i == numOfItems)
+				{
+					break;
+				}
+				pending[i]      = false;
+				auto c          = &configItems[i];
+				c->version      = latest[i].version;
+				c->versionFutex = nullptr;
+				Debug::log("thread {} got version:{} of {}",
+				           thread_id_get(),
+				           c->version,
+				           latest[i].name);
+				// The value in the record is only a hint, as the broker
+				// frees it when the item next changes.  If it has gone
+				// read the item again rather than lose the update.
+				if (latest[i].data != nullptr &&
+				    !call_handler(c,
+				                  latest[i].name,
+				                  latest[i].data,
+				                  receivedAt,
+				                  latest[i].trace,
+				                  wokeAt))
+				{
+					resync(c, true);
+				}
 			}
+
+			// If records were discarded we may have missed the latest
+			// version of an item, so read them all from the broker.
+			if (resyncNeeded)
+			{
+				Debug::log("thread {} records dropped, resyncing", thread_id_get());
+				for (size_t i = 0; i < numOfItems; i++)
+				{
+					resync(&configItems[i]);
+				}
+			}
+		}
+
+		for (size_t i = 0; i < numOfItems; i++)
+		{
+			unsubscribe_config(configItems[i].capability, queue);
 		}
+		Timeout t2{MS_TO_TICKS(1000)};
+		queue_destroy_sealed(&t2, MALLOC_CAPABILITY, queue);
 	}
 
-} // namespace ConfigConsumer
\ No newline at end of file
+} // namespace ConfigConsumer
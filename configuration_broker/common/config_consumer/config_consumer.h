@@ -2,14 +2,168 @@
 // SPDX-License-Identifier: MIT
 
 #include <atomic>
+#include <cheri.hh>
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
+#include <errno.h>
 #include <multiwaiter.h>
 #include <token.h>
 
+#include "histogram.h"
+
 namespace ConfigConsumer
 {
 
+	/**
+	 * Untyped part of a Replica, which the consumer library writes to.
+	 * The value is double buffered: each new version is copied into
+	 * the slot not holding the current value, and then the sequence
+	 * is incremented to make it current.  A reader copies the current
+	 * slot and retries if the sequence changed while it was doing so.
+	 * Only the update after next writes to the slot being read, but
+	 * once the sequence has moved on by one the writer may already be
+	 * copying that update, so any change may mean the copy is torn.
+	 * Updates are rare, so a retry is too.
+	 */
+	class ReplicaBase
+	{
+		// Number of versions copied.  The latest is in slot
+		// (sequence & 1).
+		std::atomic<uint32_t> sequence = 0;
+
+		// Broker version held in each slot
+		uint32_t versions[2] = {0, 0};
+
+		const size_t   size;
+		uint8_t *const slots;
+
+		protected:
+		constexpr ReplicaBase(size_t size, uint8_t *slots)
+		  : size(size), slots(slots)
+		{
+		}
+
+		/**
+		 * Copy the current value to dst, returning its version,
+		 * or 0 if there is no value yet.
+		 */
+		uint32_t read(void *dst) const
+		{
+			while (true)
+			{
+				auto seq = sequence.load();
+				if (seq == 0)
+				{
+					return 0;
+				}
+				memcpy(dst, &slots[(seq & 1) * size], size);
+				auto version = versions[seq & 1];
+				if (sequence.load() == seq)
+				{
+					return version;
+				}
+			}
+		}
+
+		public:
+		/**
+		 * Copy a new version of the value.  There must only be one
+		 * thread calling this for each replica (the consumer thread
+		 * handling the item).  Returns -EINVAL if data is smaller than
+		 * the replica.
+		 */
+		int update(const void *data, uint32_t version)
+		{
+			if (CHERI::Capability{data}.bounds() < size)
+			{
+				return -EINVAL;
+			}
+			auto next = sequence.load() + 1;
+			memcpy(&slots[(next & 1) * size], data, size);
+			versions[next & 1] = version;
+			sequence.store(next);
+			return 0;
+		}
+
+		/**
+		 * The version of the current value, or 0 if there is no value.
+		 */
+		uint32_t version() const
+		{
+			auto seq = sequence.load();
+			return (seq == 0) ? 0 : versions[seq & 1];
+		}
+	};
+
+	/**
+	 * A typed copy of a configuration item held in the compartment's
+	 * own (static) memory.  Setting ConfigItem::replica to one of these
+	 * makes the consumer library copy each new version of the item into
+	 * it before calling the handler, so code that needs the current
+	 * value on a hot path can read local memory without claiming or
+	 * depending on the heap allocation holding the broker's copy.  T
+	 * must be a plain type with no pointers into the value.
+	 */
+	template<typename T>
+	class Replica : public ReplicaBase
+	{
+		alignas(T) uint8_t buffer[2 * sizeof(T)] = {};
+
+		public:
+		constexpr Replica() : ReplicaBase(sizeof(T), buffer) {}
+
+		/**
+		 * Copy the current value into value, returning its version or
+		 * 0 (leaving value unchanged) if there is no value yet.
+		 */
+		uint32_t get(T &value) const
+		{
+			return read(&value);
+		}
+	};
+
+	/**
+	 * Latency of the updates to an item, in cycles.  total is from the
+	 * provider receiving an update (or the broker committing it, if the
+	 * provider didn't record that) to the handler returning.  broker is
+	 * from the provider receiving it to the broker committing it, wake
+	 * from the commit to the consumer seeing the change, and handler
+	 * from then to the handler returning.  The trace of the most recent
+	 * update is kept to show where the time in a single update went.
+	 */
+	struct Latency
+	{
+		Histogram   total;
+		Histogram   broker;
+		Histogram   wake;
+		Histogram   handler;
+		ConfigTrace last;
+		uint64_t    lastWake;
+		uint64_t    lastHandled;
+
+		/**
+		 * Log the number of updates and the 50th and 99th percentile of
+		 * each histogram, using the caller's Debug context.
+		 */
+		template<typename Debug>
+		void log(const char *name) const
+		{
+			auto report = [&](const char *stage, const Histogram &h) {
+				Debug::log("{} {}: {} updates, p50 {} cycles, p99 {} cycles",
+				           name,
+				           stage,
+				           h.count,
+				           static_cast<uint32_t>(h.percentile(50)),
+				           static_cast<uint32_t>(h.percentile(99)));
+			};
+			report("total", total);
+			report("broker", broker);
+			report("wake", wake);
+			report("handler", handler);
+		}
+	};
+
 	/**
 	 * Defines a handler for a configuration item.
 	 */
@@ -19,10 +173,99 @@ namespace ConfigConsumer
 		int (*handler)(void *); // Handler to call
 		uint32_t               version;
 		std::atomic<uint32_t> *versionFutex;
+
+		// When several items change together handlers with a higher
+		// priority are called first.
+		uint8_t priority = 0;
+
+		// Lane the item is handled in when several threads share a
+		// set of items (see RunOptions::lane).
+		uint8_t lane = 0;
+
+		// Optional limits on the handler.  deadlineMs is the maximum
+		// time from the change being seen to the handler returning,
+		// and budgetCycles the maximum time spent in the handler.
+		uint32_t deadlineMs   = 0;
+		uint32_t budgetCycles = 0;
+
+		// If set, each new value is copied here before the handler
+		// (which can then be nullptr) is called.
+		ReplicaBase *replica = nullptr;
+
+		// If set, the latency of each update is recorded here.
+		Latency *latency = nullptr;
+
+		// Updated by the consumer library.
+		uint32_t missedDeadlines  = 0; // Times the deadline was missed
+		uint32_t overBudget       = 0; // Times the budget was exceeded
+		uint32_t maxHandlerCycles = 0; // Longest time in the handler
+	};
+
+	/**
+	 * Options for run()
+	 */
+	struct RunOptions
+	{
+		// Return after this many consecutive 10 second waits with no
+		// changes, or 0 to never return.
+		uint16_t maxTimeouts = 0;
+
+		// If provided this points to a multi waiter owned by the
+		// caller (initially nullptr, in which case one is created
+		// and stored there) which is kept when run returns, so a caller
+		// that restarts run after an error doesn't create a new one
+		// each time.  Otherwise run creates its own and deletes it on
+		// return.
+		MultiWaiter *multiwaiter = nullptr;
+
+		// After the first change wait up to this many mS for further
+		// changes before calling any handlers, so that a burst of
+		// updates calls each handler once with the latest value.
+		uint32_t coalesceMs = 0;
+
+		// If not negative only handle the items in this lane.  A set of
+		// threads, each calling run with the same items and a different
+		// lane, handle the lanes concurrently while the items in each
+		// lane are still handled in order.  Each thread needs its own
+		// multi waiter.
+		int16_t lane = -1;
+
+		// If provided, a bitmap in the caller's global memory with at
+		// least one bit per item (one word per 32 items).  Rather than
+		// a multi waiter with an entry for each item, the broker marks
+		// the items that change in the bitmap and run waits on the
+		// broker's single change sequence.  Each thread needs its own
+		// bitmap.
+		std::atomic<uint32_t> *changeBits = nullptr;
 	};
 
 	// Method call by a thread to wait for and process updates
-	// to configurtion items
-	void __cheri_libcall run(ConfigItem configItems[], size_t numOfItems, uint16_t maxTimeouts=0);
+	// to configurtion items.  Each time it wakes only the items
+	// that have changed are read and passed to their handler.
+	void __cheri_libcall run(ConfigItem        configItems[],
+	                         size_t            numOfItems,
+	                         const RunOptions &options);
+
+	inline void run(ConfigItem   configItems[],
+	                size_t       numOfItems,
+	                uint16_t     maxTimeouts = 0,
+	                MultiWaiter *multiwaiter = nullptr)
+	{
+		RunOptions options;
+		options.maxTimeouts = maxTimeouts;
+		options.multiwaiter = multiwaiter;
+		run(configItems, numOfItems, options);
+	}
+
+	// Method call by a thread to process updates to configuration
+	// items which the broker posts to a message queue of queueLength
+	// records.  If coalesce is set the broker discards the oldest
+	// record when the queue is full, and only the latest version of
+	// each item in the queue is passed to its handler.
+	void __cheri_libcall run_push(ConfigItem configItems[],
+	                              size_t     numOfItems,
+	                              size_t     queueLength,
+	                              bool       coalesce    = false,
+	                              uint16_t   maxTimeouts = 0);
 
 } // namespace ConfigConsumer
\ No newline at end of file
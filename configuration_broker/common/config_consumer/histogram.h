@@ -0,0 +1,83 @@
+// Copyright Configured Things Ltd and CHERIoT Contributors.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ConfigConsumer
+{
+
+	/**
+	 * Histogram of latencies in cycles.  Buckets are powers of two
+	 * each split into four, so percentiles are accurate to within
+	 * 25% without having to keep every sample.
+	 */
+	struct Histogram
+	{
+		static constexpr size_t SubBits    = 2;
+		static constexpr size_t NumBuckets = (32 - SubBits + 1) << SubBits;
+
+		uint32_t buckets[NumBuckets];
+		uint32_t count;
+
+		static size_t bucket(uint64_t cycles)
+		{
+			uint32_t v = (cycles > UINT32_MAX) ? UINT32_MAX : cycles;
+			if (v < (1U << SubBits))
+			{
+				return v;
+			}
+			size_t msb = 31 - __builtin_clz(v);
+			return ((msb - SubBits + 1) << SubBits) |
+			       ((v >> (msb - SubBits)) & ((1U << SubBits) - 1));
+		}
+
+		/// Smallest value that falls into a bucket.
+		static uint64_t lower_bound(size_t b)
+		{
+			if (b < (1U << SubBits))
+			{
+				return b;
+			}
+			size_t msb = (b >> SubBits) + SubBits - 1;
+			return (1ULL << msb) |
+			       (static_cast<uint64_t>(b & ((1U << SubBits) - 1))
+			        << (msb - SubBits));
+		}
+
+		void record(uint64_t cycles)
+		{
+			buckets[bucket(cycles)]++;
+			count++;
+		}
+
+		void add(const Histogram &other)
+		{
+			for (size_t i = 0; i < NumBuckets; i++)
+			{
+				buckets[i] += other.buckets[i];
+			}
+			count += other.count;
+		}
+
+		/// Upper bound of the bucket holding the given percentile.
+		uint64_t percentile(uint32_t p) const
+		{
+			uint64_t target = (static_cast<uint64_t>(count) * p + 99) / 100;
+			uint64_t seen   = 0;
+			for (size_t i = 0; i < NumBuckets; i++)
+			{
+				seen += buckets[i];
+				if (seen >= target && seen > 0)
+				{
+					return (i + 1 < NumBuckets) ? lower_bound(i + 1) - 1
+					                            : UINT32_MAX;
+				}
+			}
+			return 0;
+		}
+	};
+
+} // namespace ConfigConsumer
@@ -4,4 +4,5 @@
 -- library for JSON parser   
 library("config_consumer")
     set_default(false)
+    add_deps("message_queue")
     add_files("config_consumer.cc")
\ No newline at end of file
@@ -0,0 +1,21 @@
+// Copyright Configured Things Ltd and CHERIoT Contributors.
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Example of a derived configuration item, computed by the broker
+ * from the RGB LED and User LED configuration rather than being set
+ * by a provider.  Holds how many of each kind of LED are lit.
+ */
+namespace ledState
+{
+
+	struct Config
+	{
+		uint8_t rgbOn;  // RGB LEDs with any colour set
+		uint8_t userOn; // User LEDs that are on
+	};
+
+} // namespace ledState
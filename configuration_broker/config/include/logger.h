@@ -1,8 +1,11 @@
 // Copyright Configured Things Ltd and CHERIoT Contributors.
 // SPDX-License-Identifier: MIT
+#pragma once
 
 #include <stdlib.h>
 
+#include "schema.h"
+
 /**
  * Contrived example of configuration data for a remote
  * logging service.
@@ -18,6 +21,7 @@ namespace logger
 		Warn  = 2,
 		Error = 3
 	};
+	CONFIG_ENUM_NAMES(logLevel, Debug, Info, Warn, Error);
 
 	struct Host
 	{
@@ -31,4 +35,25 @@ namespace logger
 		logLevel level; // required logging level
 	};
 
+	/**
+	 * Check a host address only contains digits and dots.
+	 */
+	inline bool valid_address(const void *field)
+	{
+		for (auto c = static_cast<const char *>(field); *c != '\0'; c++)
+		{
+			if ((*c != '.') && (*c < '0' || *c > '9'))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Port 0 is reserved
+	CONFIG_SCHEMA(Config,
+	              CONFIG_STRING(host.address, valid_address),
+	              CONFIG_NUMBER(host.port, 1),
+	              CONFIG_ENUM(level));
+
 }; // namespace logger
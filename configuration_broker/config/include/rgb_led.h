@@ -1,8 +1,11 @@
 // Copyright Configured Things Ltd and CHERIoT Contributors.
 // SPDX-License-Identifier: MIT
+#pragma once
 
 #include <stdlib.h>
 
+#include "schema.h"
+
 // Mocked example of configuration data for a controller
 // with two RGB LEDs (such as on the Sonata Board)
 
@@ -22,4 +25,12 @@ namespace rgbLed
 		Colour led1; // Settings for LED 1
 	};
 
+	CONFIG_SCHEMA(Config,
+	              CONFIG_NUMBER(led0.red),
+	              CONFIG_NUMBER(led0.green),
+	              CONFIG_NUMBER(led0.blue),
+	              CONFIG_NUMBER(led1.red),
+	              CONFIG_NUMBER(led1.green),
+	              CONFIG_NUMBER(led1.blue));
+
 } // namespace rgbLed
@@ -0,0 +1,529 @@
+// Copyright Configured Things Ltd and CHERIoT Contributors.
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <limits>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+/**
+ *
+ * Declarative schemas for configuration items.  A schema lists
+ * the fields of a config struct along with their types and valid
+ * ranges, and is declared next to the struct with CONFIG_SCHEMA,
+ * for example:
+ *
+ *   CONFIG_SCHEMA(Config,
+ *                 CONFIG_NUMBER(led0.red),
+ *                 CONFIG_NUMBER(port, 1),
+ *                 CONFIG_ENUM(level));
+ *
+ * which defines a Schema struct in the enclosing namespace.  The
+ * key of each field is its (dotted) member name.  A member which is
+ * an array is given as an array of values, which must have one value
+ * for each element.
+ *
+ * Parsers are generated from the schema with the macros in
+ * config/schema_parser.h (for items that are provided as a
+ * struct) and config/parser_helper.h (for items provided as
+ * JSON), and consumers can use config_diff() to find out which
+ * fields have changed.
+ *
+ */
+
+/**
+ * Types of field a schema can describe.
+ */
+enum class ConfigFieldType : uint8_t
+{
+	Number,
+	Enum,
+	String,
+};
+
+/**
+ * An entry in a schema.  Use the CONFIG_NUMBER, CONFIG_ENUM and
+ * CONFIG_STRING macros to create these.
+ */
+struct ConfigField
+{
+	const char     *path;   // Dotted path of the field
+	size_t          offset; // Offset of the field in the struct
+	size_t          size;   // Size of the field, or of each element
+	ConfigFieldType type;
+	bool            isSigned;       // Number is a signed type
+	uint8_t         fractionDigits; // Number is fixed point
+	uint8_t         count;          // Number of elements, 0 if not an array
+	int64_t         min;            // Range of a number
+	int64_t         max;
+	// Convert the string representation of an enum
+	bool (*toEnum)(const char *value, size_t valueLength, void *field);
+	// Optional extra check on the value once it has been stored
+	bool (*isValid)(const void *field);
+};
+
+/**
+ * Number of values held by a field, and the space they take.
+ */
+constexpr size_t config_field_elements(const ConfigField &f)
+{
+	return (f.count > 0) ? f.count : 1;
+}
+
+constexpr size_t config_field_length(const ConfigField &f)
+{
+	return f.size * config_field_elements(f);
+}
+
+/**
+ * Maximum number of fields in a schema (as they are tracked
+ * with a bitmap).
+ */
+static constexpr size_t ConfigMaxFields = 32;
+
+/**
+ * Maximum size of a value (or of one element of an array), so that
+ * a parser can convert and check it before storing it in the item.
+ */
+static constexpr size_t ConfigMaxValueSize = 64;
+
+/**
+ * Maximum number of keys in the path to a field, counting one for
+ * the prefix of its section when the item is part of a larger
+ * document (see config/parser_helper.h).  The binders don't recurse
+ * into objects any deeper than this, so it bounds their stack use.
+ */
+static constexpr size_t ConfigMaxDepth = 3;
+
+/**
+ * Number of keys in a dotted path.
+ */
+constexpr size_t config_path_depth(const char *path)
+{
+	size_t depth = 1;
+	for (auto c = path; *c != '\0'; c++)
+	{
+		if (*c == '.')
+		{
+			depth++;
+		}
+	}
+	return depth;
+}
+
+/**
+ * The names of the values of an enum, held as a constexpr table in
+ * read only memory so that they can be matched against a value in
+ * place without any heap.  Use CONFIG_ENUM_NAMES to create one.
+ */
+template<typename T, size_t N>
+struct ConfigEnumNames
+{
+	T                values[N];
+	std::string_view names[N];
+
+	/**
+	 * Build the table from the values and a string of their comma
+	 * separated names, as produced by stringizing the list.
+	 */
+	constexpr ConfigEnumNames(const T (&v)[N], std::string_view list)
+	  : values{}, names{}
+	{
+		for (size_t i = 0; i < N; i++)
+		{
+			auto end  = list.find(',');
+			auto name = list.substr(0, end);
+			while (!name.empty() && name.front() == ' ')
+			{
+				name.remove_prefix(1);
+			}
+			while (!name.empty() && name.back() == ' ')
+			{
+				name.remove_suffix(1);
+			}
+			values[i] = v[i];
+			names[i]  = name;
+			list = (end == std::string_view::npos) ? "" : list.substr(end + 1);
+		}
+	}
+
+	/**
+	 * Find the value with a name, ignoring case.
+	 */
+	constexpr bool find(std::string_view name, T &value) const
+	{
+		for (size_t i = 0; i < N; i++)
+		{
+			if (names[i].size() != name.size())
+			{
+				continue;
+			}
+			size_t c = 0;
+			while (c < name.size() && lower(names[i][c]) == lower(name[c]))
+			{
+				c++;
+			}
+			if (c == name.size())
+			{
+				value = values[i];
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	 * Check a value is one of the named values.
+	 */
+	constexpr bool contains(T value) const
+	{
+		for (size_t i = 0; i < N; i++)
+		{
+			if (values[i] == value)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	private:
+	static constexpr char lower(char c)
+	{
+		return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+	}
+};
+
+/**
+ * Declare the names of the values of Enum, which must be given in
+ * the same form as the enumerators, for example:
+ *
+ *   CONFIG_ENUM_NAMES(State, Off, On);
+ *
+ * This must be in the same namespace as the enum, as the schema
+ * finds the table by argument dependent lookup.
+ */
+#define CONFIG_ENUM_NAMES(Enum, ...)                                           \
+	constexpr auto config_enum_names(Enum)                                     \
+	{                                                                          \
+		using enum Enum;                                                       \
+		return ConfigEnumNames{{__VA_ARGS__}, #__VA_ARGS__};                   \
+	}
+
+/**
+ * Convert the string representation of an enum value, treating it
+ * as case insensitive.
+ */
+template<class T>
+bool config_enum_from_string(const char *value, size_t valueLength, void *field)
+{
+	static constexpr auto Names = config_enum_names(T{});
+	T                     m;
+	if (!Names.find(std::string_view{value, valueLength}, m))
+	{
+		return false;
+	}
+	*static_cast<T *>(field) = m;
+	return true;
+}
+
+/**
+ * Check an enum field holds one of the named values.
+ */
+template<class T>
+bool config_enum_valid(const void *field)
+{
+	static constexpr auto Names = config_enum_names(T{});
+	T                     value;
+	memcpy(&value, field, sizeof(value));
+	return Names.contains(value);
+}
+
+/**
+ * Number of elements in a member of type T, or 0 if T is not an
+ * array (or is the char array of a string).
+ */
+template<class T, size_t ArrayRank = 1>
+constexpr uint8_t config_element_count()
+{
+	static_assert(std::rank_v<T> <= ArrayRank,
+	              "Schema arrays must have one dimension");
+	static_assert(std::rank_v<T> < ArrayRank || std::extent_v<T> <= UINT8_MAX,
+	              "Schema arrays must have at most 255 elements");
+	return (std::rank_v<T> == ArrayRank) ? std::extent_v<T> : 0;
+}
+
+template<class T, class E = std::remove_extent_t<T>>
+constexpr ConfigField
+config_number(const char *path,
+              size_t      offset,
+              int64_t     min             = std::numeric_limits<E>::min(),
+              int64_t     max             = std::numeric_limits<E>::max(),
+              bool (*isValid)(const void *) = nullptr)
+{
+	static_assert(std::is_integral_v<E> && sizeof(E) <= sizeof(int32_t),
+	              "Schema numbers must be integers of up to 32 bits");
+	return {path,
+	        offset,
+	        sizeof(E),
+	        ConfigFieldType::Number,
+	        std::is_signed_v<E>,
+	        0,
+	        config_element_count<T>(),
+	        min,
+	        max,
+	        nullptr,
+	        isValid};
+}
+
+template<class T, class E = std::remove_extent_t<T>>
+constexpr ConfigField config_enum(const char *path, size_t offset)
+{
+	static_assert(std::is_enum_v<E>, "Schema enums must be enums");
+	return {path,
+	        offset,
+	        sizeof(E),
+	        ConfigFieldType::Enum,
+	        std::is_signed_v<std::underlying_type_t<E>>,
+	        0,
+	        config_element_count<T>(),
+	        0,
+	        0,
+	        config_enum_from_string<E>,
+	        config_enum_valid<E>};
+}
+
+template<class T, class E = std::remove_extent_t<T>>
+constexpr ConfigField
+config_fixed(const char *path,
+             size_t      offset,
+             uint8_t     fractionDigits,
+             int64_t     min = std::numeric_limits<E>::min(),
+             int64_t     max = std::numeric_limits<E>::max())
+{
+	ConfigField f    = config_number<T>(path, offset, min, max);
+	f.fractionDigits = fractionDigits;
+	return f;
+}
+
+template<class T>
+constexpr ConfigField config_string(const char *path,
+                                    size_t      offset,
+                                    bool (*isValid)(const void *) = nullptr)
+{
+	using E = std::conditional_t<(std::rank_v<T> > 1),
+	                             std::remove_extent_t<T>,
+	                             T>;
+	static_assert(std::is_same_v<std::remove_all_extents_t<T>, char>,
+	              "Schema strings must be char arrays");
+	static_assert(sizeof(E) <= ConfigMaxValueSize,
+	              "Schema strings must fit in ConfigMaxValueSize");
+	return {path,
+	        offset,
+	        sizeof(E),
+	        ConfigFieldType::String,
+	        false,
+	        0,
+	        config_element_count<T, 2>(),
+	        0,
+	        0,
+	        nullptr,
+	        isValid};
+}
+
+/**
+ * Type of a (possibly nested) member of a struct.
+ */
+#define CONFIG_FIELD_TYPE(Struct, member)                                      \
+	std::remove_cvref_t<decltype(std::declval<Struct>().member)>
+
+/**
+ * An integer member, optionally limited to the range min..max and
+ * with an extra check of the value.  Only valid inside CONFIG_SCHEMA.
+ *
+ * Each of these macros can also be used for an array member, in
+ * which case the range and checks apply to every element.
+ */
+#define CONFIG_NUMBER(member, ...)                                             \
+	config_number<CONFIG_FIELD_TYPE(Type, member)>(                            \
+	  #member, offsetof(Type, member), ##__VA_ARGS__)
+
+/**
+ * An integer member holding a fixed point value with fractionDigits
+ * decimal places, so with 2 a value of 1.25 is stored as 125.  The
+ * range is in the same units.  Only valid inside CONFIG_SCHEMA.
+ */
+#define CONFIG_FIXED(member, fractionDigits, ...)                              \
+	config_fixed<CONFIG_FIELD_TYPE(Type, member)>(                             \
+	  #member, offsetof(Type, member), fractionDigits, ##__VA_ARGS__)
+
+/**
+ * An enum member, which must hold one of the named values.  Only
+ * valid inside CONFIG_SCHEMA.
+ */
+#define CONFIG_ENUM(member)                                                    \
+	config_enum<CONFIG_FIELD_TYPE(Type, member)>(#member,                      \
+	                                             offsetof(Type, member))
+
+/**
+ * A nul terminated char array member, optionally with an extra check
+ * of the string.  An array of strings is a two dimensional char array.
+ * Only valid inside CONFIG_SCHEMA.
+ */
+#define CONFIG_STRING(member, ...)                                             \
+	config_string<CONFIG_FIELD_TYPE(Type, member)>(                            \
+	  #member, offsetof(Type, member), ##__VA_ARGS__)
+
+/**
+ * Check the layout of a schema, i.e. that every field is within
+ * the struct, no two fields overlap, each number range is valid for
+ * the size of its field, and each path leaves room for a section
+ * prefix within ConfigMaxDepth.
+ */
+constexpr bool config_schema_valid(const ConfigField fields[],
+                                   size_t            numFields,
+                                   size_t            size)
+{
+	if (numFields == 0 || numFields > ConfigMaxFields)
+	{
+		return false;
+	}
+	for (size_t i = 0; i < numFields; i++)
+	{
+		auto &f = fields[i];
+		if (f.size == 0 || f.offset + config_field_length(f) > size ||
+		    f.min > f.max || f.fractionDigits > 9 ||
+		    config_path_depth(f.path) >= ConfigMaxDepth)
+		{
+			return false;
+		}
+		for (size_t j = 0; j < i; j++)
+		{
+			if (f.offset < fields[j].offset + config_field_length(fields[j]) &&
+			    fields[j].offset < f.offset + config_field_length(f))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/**
+ * Hash of the layout of a schema (FNV-1a over the path, offset,
+ * size, type, signedness, fraction digits, element count and range
+ * of each field,
+ * followed by the size of the struct), used to check a compiled
+ * config blob was built for the same layout.  tools/config_blob.py
+ * must compute the same value.
+ */
+constexpr uint32_t config_schema_hash(const ConfigField fields[],
+                                      size_t            numFields,
+                                      size_t            size)
+{
+	uint32_t hash = 2166136261U;
+	auto     add  = [&hash](uint64_t value, size_t bytes) {
+		for (size_t i = 0; i < bytes; i++)
+		{
+			hash = (hash ^ ((value >> (8 * i)) & 0xff)) * 16777619U;
+		}
+	};
+	for (size_t i = 0; i < numFields; i++)
+	{
+		auto &f = fields[i];
+		for (auto c = f.path; *c != '\0'; c++)
+		{
+			add(static_cast<uint8_t>(*c), 1);
+		}
+		add(0, 1);
+		add(f.offset, 4);
+		add(f.size, 4);
+		add(static_cast<uint8_t>(f.type), 1);
+		add(f.isSigned, 1);
+		add(f.fractionDigits, 1);
+		add(f.count, 1);
+		add(f.min, 8);
+		add(f.max, 8);
+	}
+	add(size, 4);
+	return hash;
+}
+
+/**
+ * Declare the schema of ConfigType as a struct called Schema in
+ * the enclosing namespace, with the fields given by the remaining
+ * arguments.  The layout is checked at compile time.
+ */
+#define CONFIG_SCHEMA(ConfigType, ...)                                         \
+	struct Schema                                                              \
+	{                                                                          \
+		using Type                                  = ConfigType;              \
+		static constexpr ConfigField Fields[]       = {__VA_ARGS__};           \
+		static constexpr size_t      NumFields      =                          \
+		  sizeof(Fields) / sizeof(Fields[0]);                                  \
+		static constexpr uint32_t Hash =                                       \
+		  config_schema_hash(Fields, NumFields, sizeof(ConfigType));           \
+	};                                                                         \
+	static_assert(config_schema_valid(                                         \
+	                Schema::Fields, Schema::NumFields, sizeof(ConfigType)),    \
+	              "Invalid schema for " #ConfigType)
+
+/**
+ * Find the index of a field in a schema, or -1 if there is no field
+ * with that path.  Can be used to build masks for config_diff().
+ */
+template<typename Schema>
+constexpr int config_field_index(std::string_view path)
+{
+	for (size_t i = 0; i < Schema::NumFields; i++)
+	{
+		if (path == Schema::Fields[i].path)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+/**
+ * Compare two values of a config item.  Returns a bitmap with
+ * bit i set if field i of the schema differs.
+ */
+template<typename Schema>
+uint32_t config_diff(const typename Schema::Type &a,
+                     const typename Schema::Type &b)
+{
+	auto     pa      = reinterpret_cast<const uint8_t *>(&a);
+	auto     pb      = reinterpret_cast<const uint8_t *>(&b);
+	uint32_t changed = 0;
+	for (size_t i = 0; i < Schema::NumFields; i++)
+	{
+		auto &f      = Schema::Fields[i];
+		bool  differ = false;
+		if (f.type == ConfigFieldType::String)
+		{
+			for (size_t e = 0; e < config_field_elements(f); e++)
+			{
+				auto offset = f.offset + e * f.size;
+				differ |= strncmp(reinterpret_cast<const char *>(pa + offset),
+				                  reinterpret_cast<const char *>(pb + offset),
+				                  f.size) != 0;
+			}
+		}
+		else
+		{
+			differ = memcmp(pa + f.offset,
+			                pb + f.offset,
+			                config_field_length(f)) != 0;
+		}
+		if (differ)
+		{
+			changed |= (1U << i);
+		}
+	}
+	return changed;
+}
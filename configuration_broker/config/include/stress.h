@@ -0,0 +1,38 @@
+// Copyright Configured Things Ltd and CHERIoT Contributors.
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <stdlib.h>
+
+/**
+ * Configuration data used to load the broker in the
+ * stress benchmark.  Values are written as raw structs
+ * rather than JSON so that the benchmark measures the
+ * broker rather than the parser.
+ */
+namespace stress
+{
+	/// Number of items the benchmark spreads its load over.
+	static constexpr size_t NumItems = 8;
+
+	struct Value
+	{
+		uint32_t writer;   // Thread that wrote the value
+		uint32_t sequence; // Writer's sequence number
+		uint64_t written;  // Cycle count when it was written
+	};
+
+	/// Number of entries in the lookup table.
+	static constexpr size_t TableEntries = 256;
+
+	/**
+	 * A large item, such as a lookup table, which the broker holds
+	 * compressed and is read back with read_config_into().
+	 */
+	struct Table
+	{
+		uint32_t sequence;              // Writer's sequence number
+		uint8_t  entries[TableEntries]; // Table contents
+	};
+
+} // namespace stress
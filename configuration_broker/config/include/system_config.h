@@ -1,9 +1,12 @@
 // Copyright Configured Things Ltd and CHERIoT Contributors.
 // SPDX-License-Identifier: MIT
+#pragma once
 
 #include <algorithm>
 #include <stdlib.h>
 
+#include "schema.h"
+
 // System configurartion data, such as
 // id and current switch settings
 
@@ -18,4 +21,26 @@ namespace systemConfig
 		bool switches[8];
 	};
 
+	/**
+	 * Check an id only contains letters, digits, '-' and '_', as
+	 * it is used to build MQTT topic names.
+	 */
+	inline bool valid_id(const void *field)
+	{
+		for (auto c = static_cast<const char *>(field); *c != '\0'; c++)
+		{
+			if (!((*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') ||
+			      (*c >= '0' && *c <= '9') || (*c == '-') || (*c == '_')))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Each switch must be a valid bool, i.e. 0 or 1
+	CONFIG_SCHEMA(Config,
+	              CONFIG_STRING(id, valid_id),
+	              CONFIG_NUMBER(switches));
+
 } // namespace systemConfig
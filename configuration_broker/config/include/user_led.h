@@ -1,12 +1,17 @@
 // Copyright Configured Things Ltd and CHERIoT Contributors.
 // SPDX-License-Identifier: MIT
+#pragma once
 
 #include <stdlib.h>
 
+#include "schema.h"
+
 /**
  * Mocked example of configuration data for a controller
- * with a set of eight LEDs that can be turned on and off
- * (such as the user LEDs on a Sonata Board)
+ * with a set of LEDs that can be turned on and off (such as
+ * the eight user LEDs on a Sonata Board), given as an array
+ * with the state of each LED, for example
+ *   {"leds": ["on", "off", "on", "off", "on", "off", "on", "off"]}
  */
 namespace userLed
 {
@@ -16,17 +21,16 @@ namespace userLed
 		Off = 0,
 		On  = 1,
 	};
+	CONFIG_ENUM_NAMES(State, Off, On);
+
+	/// Number of LEDs on the controller
+	static constexpr size_t NumLeds = 8;
 
 	struct Config
 	{
-		State led0;
-		State led1;
-		State led2;
-		State led3;
-		State led4;
-		State led5;
-		State led6;
-		State led7;
+		State leds[NumLeds];
 	};
 
+	CONFIG_SCHEMA(Config, CONFIG_ENUM(leds));
+
 } // namespace userLed
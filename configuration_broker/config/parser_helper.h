@@ -2,12 +2,19 @@
 // SPDX-License-Identifier: MIT
 #pragma once
 
+#include <cheri.hh>
 #include <compartment.h>
-#include <magic_enum/magic_enum.hpp>
+#include <ctype.h>
+#include <errno.h>
+#include <limits>
 #include <stddef.h>
 #include <string.h>
+#include <string_view>
+#include <thread.h>
 
+#include "../../third_party/cbor_parser/cbor_parser.h"
 #include "../../third_party/json_parser/json_parser.h"
+#include "schema_parser.h"
 
 /**
  *
@@ -39,10 +46,8 @@ bool get_string(const char *json, size_t jsonLength, const char *key, char *dst)
 }
 
 /**
- * Function template to extract a number value. If after
- * assignment *dst doesn't equal the value we tried to save
- * then we assume that the value has overflowed and is not
- * valid for the type.
+ * Function template to extract a number value, which must
+ * be in the range of the type.
  */
 template<class T>
 bool get_number(const char *json, size_t jsonLength, const char *key, T *dst)
@@ -59,69 +64,842 @@ bool get_number(const char *json, size_t jsonLength, const char *key, T *dst)
 		return false;
 	}
 
-	bool  isNumber = true;
-	int   acc      = 0;
-	char *str      = value;
-	for (int i = 0; i < valueLength && str; i++, str++)
+	int64_t acc;
+	if (jsonParser::to_number(value,
+	                          valueLength,
+	                          std::numeric_limits<T>::min(),
+	                          std::numeric_limits<T>::max(),
+	                          &acc) != 0)
 	{
-		if (isNumber && isdigit(*str))
+		Debug::log("{} is not a number in range", key);
+		return false;
+	}
+
+	*dst = acc;
+	return true;
+}
+
+/**
+ * Extract an enum value based on it's string representation
+ * using the table from CONFIG_ENUM_NAMES. The value in JSON is
+ * treated as being case insensitive.
+ */
+template<class T>
+bool get_enum(const char *json, size_t jsonLength, const char *key, T *dst)
+{
+	char  *value;
+	size_t valueLength;
+
+	auto result = jsonParser::search(
+	  (char *)json, jsonLength, (char *)key, strlen(key), &value, &valueLength);
+
+	if (result != JSONSuccess)
+	{
+		Debug::log("Missing key {} in {}", key, json);
+		return false;
+	}
+
+	if (!config_enum_from_string<T>(value, valueLength, dst))
+	{
+		Debug::log("Invalid emum value {} for {}",
+		           std::string_view{value, valueLength},
+		           key);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ *
+ * A binder which fills in one or more destination structs from the
+ * schemas of the items (see config/include/schema.h) in a single
+ * pass over the document, rather than searching the document from
+ * the start for each field.  Each schema is bound as a section of
+ * the document, optionally under a prefix, for example:
+ *
+ *   static constexpr ConfigSection LedSections[] = {
+ *     config_section<rgbLed::Schema>("rgb"),
+ *     config_section<userLed::Schema>("user"),
+ *   };
+ *   parsed = bind_config(src, srcLength, LedSections, dst);
+ *
+ * The document can be JSON or the equivalent in CBOR (see
+ * third_party/cbor_parser), which is told apart by its first byte
+ * being a CBOR map.  Every field in the schemas must be present in
+ * the document.  Keys that are not in a schema are reported but
+ * otherwise ignored.
+ *
+ * Items which only have a single schema can use
+ * DEFINE_JSON_CONFIG_PARSER to generate the whole parser.
+ *
+ */
+
+/**
+ * The fields of one destination struct, and the key of the object
+ * in the document that holds them ("" for the top level).
+ */
+struct ConfigSection
+{
+	const char        *prefix;
+	const ConfigField *fields;
+	size_t             numFields;
+};
+
+template<typename Schema>
+constexpr ConfigSection config_section(const char *prefix = "")
+{
+	return {prefix, Schema::Fields, Schema::NumFields};
+}
+
+/**
+ * Maximum length of a key path, and the number of fields across all
+ * of the sections (as they are tracked with a bitmap).
+ */
+static constexpr size_t JsonMaxPath   = 64;
+static constexpr size_t JsonMaxFields = ConfigMaxFields;
+
+/**
+ * Check a document is CBOR, i.e. starts with a map (major type 5),
+ * which JSON can't as all of its structural characters are ASCII.
+ */
+inline bool is_cbor(const void *src, size_t srcLength)
+{
+	return (srcLength > 0) &&
+	       ((static_cast<const uint8_t *>(src)[0] & 0xe0) == 0xa0);
+}
+
+/**
+ * Range check a number and store it in a field (or a local value).
+ */
+bool store_number(const ConfigField &f,
+                  int64_t            value,
+                  const char        *path,
+                  void              *field)
+{
+	if (value < f.min || value > f.max)
+	{
+		Debug::log(
+		  "Value {} for {} out of range", static_cast<int32_t>(value), path);
+		return false;
+	}
+	// The range check means the value fits in the field, so
+	// copy the low bytes (which come first on little endian).
+	memcpy(field, &value, f.size);
+	return true;
+}
+
+/**
+ * Store a string in a field (or a local value), with a nul terminator.
+ */
+bool store_string(const ConfigField &f,
+                  const char        *value,
+                  size_t             valueLength,
+                  const char        *path,
+                  void              *field)
+{
+	if (valueLength >= f.size)
+	{
+		Debug::log("Invalid string for {}", path);
+		return false;
+	}
+	memcpy(field, value, valueLength);
+	static_cast<char *>(field)[valueLength] = '\0';
+	return true;
+}
+
+/**
+ * Run any extra check on a value converted into a local buffer, and
+ * then store it in the field.  The field is write only to a parser
+ * in a sandbox, so the check can't read the value back from there.
+ */
+bool check_and_store(const ConfigField &f,
+                     const char        *path,
+                     const void        *value,
+                     void              *field)
+{
+	if (f.isValid != nullptr && !f.isValid(value))
+	{
+		Debug::log("Invalid value for {}", path);
+		return false;
+	}
+	memcpy(field, value, f.size);
+	return true;
+}
+
+/**
+ * Convert a JSON value and store it in the field.
+ */
+bool bind_value(const ConfigField &f,
+                const JSONPair_t  &pair,
+                const char        *path,
+                void              *field)
+{
+	// Zeroed so nothing from the stack follows a string
+	alignas(int64_t) uint8_t value[ConfigMaxValueSize] = {};
+
+	switch (f.type)
+	{
+		case ConfigFieldType::Number:
 		{
-			isNumber = true;
-			acc *= 10;
-			acc += *str - 0x30;
+			int64_t acc;
+			int     res = -EINVAL;
+			if (pair.jsonType == JSONNumber && f.fractionDigits > 0)
+			{
+				res = jsonParser::to_fixed(
+				  pair.value, pair.valueLength, f.fractionDigits, &acc);
+			}
+			else if (pair.jsonType == JSONNumber)
+			{
+				res = jsonParser::to_int64(pair.value, pair.valueLength, &acc);
+			}
+			if (res != 0)
+			{
+				Debug::log("{} is not a number in range", path);
+				return false;
+			}
+			if (!store_number(f, acc, path, value))
+			{
+				return false;
+			}
+			break;
 		}
-		else
+
+		case ConfigFieldType::Enum:
+			if (pair.jsonType != JSONString ||
+			    !f.toEnum(pair.value, pair.valueLength, value))
+			{
+				Debug::log("Invalid enum value {} for {}",
+				           std::string_view{pair.value, pair.valueLength},
+				           path);
+				return false;
+			}
+			break;
+
+		case ConfigFieldType::String:
+			if (pair.jsonType != JSONString)
+			{
+				Debug::log("{} is not a string", path);
+				return false;
+			}
+			if (!store_string(f, pair.value, pair.valueLength, path, value))
+			{
+				return false;
+			}
+			break;
+	}
+
+	return check_and_store(f, path, value, field);
+}
+
+/**
+ * Convert a CBOR value and store it in the field.  Fixed point
+ * numbers are given already scaled, and enums can be given either
+ * by name or by value.
+ */
+bool bind_value(const ConfigField            &f,
+                const cborParser::CborItem &item,
+                const char                 *path,
+                void                       *field)
+{
+	using cborParser::CborType;
+
+	// Zeroed so nothing from the stack follows a string
+	alignas(int64_t) uint8_t value[ConfigMaxValueSize] = {};
+
+	auto text = reinterpret_cast<const char *>(item.data);
+	switch (f.type)
+	{
+		case ConfigFieldType::Number:
+		{
+			int64_t number;
+			if (cborParser::to_int64(item, &number) != 0)
+			{
+				Debug::log("{} is not a number in range", path);
+				return false;
+			}
+			if (!store_number(f, number, path, value))
+			{
+				return false;
+			}
+			break;
+		}
+
+		case ConfigFieldType::Enum:
+			if (item.type == CborType::Text)
+			{
+				if (!f.toEnum(text, item.size, value))
+				{
+					Debug::log("Invalid enum value {} for {}",
+					           std::string_view{text, item.size},
+					           path);
+					return false;
+				}
+				break;
+			}
+			if (item.type != CborType::Unsigned || item.value > INT32_MAX)
+			{
+				Debug::log("Invalid enum value for {}", path);
+				return false;
+			}
+			// The field's isValid checks this is a named value
+			memcpy(value, &item.value, f.size);
+			break;
+
+		case ConfigFieldType::String:
+			if (item.type != CborType::Text)
+			{
+				Debug::log("{} is not a string", path);
+				return false;
+			}
+			if (!store_string(f, text, item.size, path, value))
+			{
+				return false;
+			}
+			break;
+	}
+
+	return check_and_store(f, path, value, field);
+}
+
+/**
+ * Convert each value of a JSON array and store it in the elements of
+ * an array field.  There must be a value for every element.
+ */
+bool bind_array(const ConfigField &f,
+                const JSONPair_t  &pair,
+                const char        *path,
+                void              *field)
+{
+	if (pair.jsonType != JSONArray)
+	{
+		Debug::log("{} is not an array", path);
+		return false;
+	}
+
+	size_t       start = 0;
+	size_t       next  = 0;
+	size_t       count = 0;
+	JSONPair_t   element;
+	JSONStatus_t result;
+	while ((result = jsonParser::iterate(
+	          pair.value, pair.valueLength, &start, &next, &element)) ==
+	         JSONSuccess &&
+	       count < f.count)
+	{
+		if (!bind_value(
+		      f, element, path, static_cast<char *>(field) + count * f.size))
 		{
-			isNumber = false;
+			return false;
 		}
+		count++;
 	}
 
-	if (!isNumber)
+	if (result != JSONNotFound || count != f.count)
 	{
-		Debug::log("{} is not a number", key);
+		Debug::log("Expected {} values for {}", f.count, path);
 		return false;
 	}
+	return true;
+}
 
-	*dst = acc;
-	// Check we haven't lost something in the cast
-	if (*dst != acc)
+/**
+ * Convert each value of a CBOR array and store it in the elements of
+ * an array field.
+ */
+bool bind_array(const ConfigField            &f,
+                const cborParser::CborItem &item,
+                const char                 *path,
+                void                       *field)
+{
+	if (item.type != cborParser::CborType::Array || item.value != f.count)
 	{
-		Debug::log("Value truncated {} -> {}", acc, *dst);
+		Debug::log("Expected {} values for {}", f.count, path);
 		return false;
 	}
 
+	size_t               offset = 0;
+	cborParser::CborItem element;
+	for (size_t i = 0; i < f.count; i++)
+	{
+		if (cborParser::next(item.data, item.size, &offset, &element) != 0 ||
+		    !bind_value(
+		      f, element, path, static_cast<char *>(field) + i * f.size))
+		{
+			return false;
+		}
+	}
 	return true;
 }
 
 /**
- * Extract an enum value based on it's string representation
- * using magic enum. The value in JSON is treated as being
- * case insensitive.
+ * Store a JSON or CBOR value in a field, or an array of them in an
+ * array field.
  */
-template<class T>
-bool get_enum(const char *json, size_t jsonLength, const char *key, T *dst)
+template<typename Value>
+bool bind_field(const ConfigField &f,
+                const Value       &value,
+                const char        *path,
+                void              *field)
 {
-	char  *value;
-	size_t valueLength;
+	return (f.count > 0) ? bind_array(f, value, path, field)
+	                     : bind_value(f, value, path, field);
+}
 
-	auto result = jsonParser::search(
-	  (char *)json, jsonLength, (char *)key, strlen(key), &value, &valueLength);
+/**
+ * Find the field for a key path, or nullptr if there isn't one.
+ * Sets section to the section the field is in, and index to the
+ * index of the field across all of the sections.
+ */
+const ConfigField *find_field(const char          *path,
+                              const ConfigSection  sections[],
+                              size_t               numSections,
+                              size_t              &section,
+                              size_t              &index)
+{
+	index = 0;
+	for (section = 0; section < numSections; section++)
+	{
+		auto  &s            = sections[section];
+		size_t prefixLength = strlen(s.prefix);
+		auto   key          = path;
+		if (prefixLength > 0)
+		{
+			if (strncmp(path, s.prefix, prefixLength) != 0 ||
+			    path[prefixLength] != '.')
+			{
+				index += s.numFields;
+				continue;
+			}
+			key = &path[prefixLength + 1];
+		}
 
-	if (result != JSONSuccess)
+		for (size_t i = 0; i < s.numFields; i++, index++)
+		{
+			if (strncmp(s.fields[i].path, key, JsonMaxPath) == 0)
+			{
+				return &s.fields[i];
+			}
+		}
+	}
+	return nullptr;
+}
+
+/**
+ * Add a key to the path of its object.  Returns the new length, or
+ * 0 if it doesn't fit.
+ */
+size_t
+append_path(char *path, size_t pathLength, const char *key, size_t keyLength)
+{
+	size_t keyPathLength = pathLength + (pathLength > 0 ? 1 : 0) + keyLength;
+	if (key == nullptr || keyLength == 0 || keyPathLength >= JsonMaxPath)
 	{
-		Debug::log("Missing key {} in {}", key, json);
+		Debug::log("Unexpected value in {}",
+		           std::string_view{path, pathLength});
+		return 0;
+	}
+	if (pathLength > 0)
+	{
+		path[pathLength] = '.';
+	}
+	memcpy(&path[keyPathLength - keyLength], key, keyLength);
+	path[keyPathLength] = '\0';
+	return keyPathLength;
+}
+
+/**
+ * Find the field for a key path and bind a value to it with bind,
+ * which is passed the field and where to store it.  Returns false
+ * if the key is a duplicate or the value is invalid.
+ */
+template<typename Bind>
+bool bind_key(const char          *path,
+              const ConfigSection  sections[],
+              size_t               numSections,
+              void *const          dst[],
+              uint32_t            &seen,
+              Bind               &&bind)
+{
+	size_t section;
+	size_t index;
+	auto  *f = find_field(path, sections, numSections, section, index);
+	if (f == nullptr)
+	{
+		Debug::log("Unknown key {}", path);
+		return true;
+	}
+	if (seen & (1U << index))
+	{
+		Debug::log("Duplicate key {}", path);
 		return false;
 	}
+	seen |= (1U << index);
 
-	std::string enum_string = std::string(value, valueLength);
-	auto        m =
-	  magic_enum::enum_cast<T>(enum_string, magic_enum::case_insensitive);
-	if (!m.has_value())
+	return bind(*f, static_cast<char *>(dst[section]) + f->offset);
+}
+
+/**
+ * Check a nested object or map is shallow enough to hold a field.
+ * depth is the number of keys in its path, and deeper ones are
+ * skipped rather than walked, which bounds the recursion.
+ */
+bool within_depth(const char *path, size_t depth)
+{
+	if (depth >= ConfigMaxDepth)
 	{
-		Debug::log("Invalid emum value {} for {}", enum_string, key);
+		Debug::log("{} is nested too deeply", path);
 		return false;
 	}
+	return true;
+}
+
+/**
+ * Walk one JSON object in the document, recursing into any nested
+ * objects.  path holds the path of the object, of pathLength, which
+ * has depth keys.
+ */
+bool bind_object(const char          *json,
+                 size_t               jsonLength,
+                 char                *path,
+                 size_t               pathLength,
+                 size_t               depth,
+                 const ConfigSection  sections[],
+                 size_t               numSections,
+                 void *const          dst[],
+                 uint32_t            &seen)
+{
+	size_t       start = 0;
+	size_t       next  = 0;
+	JSONPair_t   pair;
+	JSONStatus_t result;
+	while ((result = jsonParser::iterate(
+	          json, jsonLength, &start, &next, &pair)) == JSONSuccess)
+	{
+		size_t keyPathLength =
+		  append_path(path, pathLength, pair.key, pair.keyLength);
+		if (keyPathLength == 0)
+		{
+			continue;
+		}
+
+		if (pair.jsonType == JSONObject)
+		{
+			if (!within_depth(path, depth + 1))
+			{
+				continue;
+			}
+			if (!bind_object(pair.value,
+			                 pair.valueLength,
+			                 path,
+			                 keyPathLength,
+			                 depth + 1,
+			                 sections,
+			                 numSections,
+			                 dst,
+			                 seen))
+			{
+				return false;
+			}
+			continue;
+		}
+
+		if (!bind_key(path,
+		              sections,
+		              numSections,
+		              dst,
+		              seen,
+		              [&](const ConfigField &f, void *field) {
+			              return bind_field(f, pair, path, field);
+		              }))
+		{
+			return false;
+		}
+	}
+
+	return result == JSONNotFound;
+}
+
+/**
+ * Walk the contents of one CBOR map in the document, recursing into
+ * any nested maps.  path holds the path of the map, of pathLength,
+ * which has depth keys.
+ */
+bool bind_map(const uint8_t       *cbor,
+              size_t               cborLength,
+              char                *path,
+              size_t               pathLength,
+              size_t               depth,
+              const ConfigSection  sections[],
+              size_t               numSections,
+              void *const          dst[],
+              uint32_t            &seen)
+{
+	using cborParser::CborType;
 
-	*dst = m.value();
+	size_t               offset = 0;
+	cborParser::CborItem key;
+	cborParser::CborItem value;
+	int                  result;
+	while ((result = cborParser::next(cbor, cborLength, &offset, &key)) == 0)
+	{
+		if (cborParser::next(cbor, cborLength, &offset, &value) != 0)
+		{
+			return false;
+		}
+
+		size_t keyPathLength =
+		  (key.type == CborType::Text)
+		    ? append_path(path,
+		                  pathLength,
+		                  reinterpret_cast<const char *>(key.data),
+		                  key.size)
+		    : 0;
+		if (keyPathLength == 0)
+		{
+			continue;
+		}
+
+		if (value.type == CborType::Map)
+		{
+			if (!within_depth(path, depth + 1))
+			{
+				continue;
+			}
+			if (!bind_map(value.data,
+			              value.size,
+			              path,
+			              keyPathLength,
+			              depth + 1,
+			              sections,
+			              numSections,
+			              dst,
+			              seen))
+			{
+				return false;
+			}
+			continue;
+		}
+
+		if (!bind_key(path,
+		              sections,
+		              numSections,
+		              dst,
+		              seen,
+		              [&](const ConfigField &f, void *field) {
+			              return bind_field(f, value, path, field);
+		              }))
+		{
+			return false;
+		}
+	}
+
+	return result == -ENOENT;
+}
+
+/**
+ * Check every field in the sections was seen.
+ */
+bool check_complete(const ConfigSection sections[],
+                    size_t              numSections,
+                    uint32_t            seen)
+{
+	bool   complete = true;
+	size_t index    = 0;
+	for (size_t s = 0; s < numSections; s++)
+	{
+		for (size_t i = 0; i < sections[s].numFields; i++, index++)
+		{
+			if (!(seen & (1U << index)))
+			{
+				Debug::log("Missing key {}{}{}",
+				           sections[s].prefix,
+				           sections[s].prefix[0] ? "." : "",
+				           sections[s].fields[i].path);
+				complete = false;
+			}
+		}
+	}
+	return complete;
+}
+
+/**
+ * Check the sections don't have too many fields to track, and that
+ * each prefix is a single key so that every field is within
+ * ConfigMaxDepth.
+ */
+bool check_sections(const ConfigSection sections[], size_t numSections)
+{
+	size_t numFields = 0;
+	for (size_t s = 0; s < numSections; s++)
+	{
+		if (strchr(sections[s].prefix, '.') != nullptr)
+		{
+			Debug::log("Prefix {} is not a single key", sections[s].prefix);
+			return false;
+		}
+		numFields += sections[s].numFields;
+	}
+	if (numFields > JsonMaxFields)
+	{
+		Debug::log("Too many fields {}", numFields);
+		return false;
+	}
 	return true;
 }
+
+/**
+ * Fill in the destination structs from a JSON document that has
+ * already been checked with jsonParser::validate().  dst holds a
+ * pointer to the struct for each section.  Returns false if any
+ * field is missing or invalid.
+ */
+bool bind_json(const char          *json,
+               size_t               jsonLength,
+               const ConfigSection  sections[],
+               size_t               numSections,
+               void *const          dst[])
+{
+	char     path[JsonMaxPath];
+	uint32_t seen = 0;
+	return check_sections(sections, numSections) &&
+	       bind_object(
+	         json, jsonLength, path, 0, 0, sections, numSections, dst, seen) &&
+	       check_complete(sections, numSections, seen);
+}
+
+/**
+ * Fill in the destination structs from a CBOR document that has
+ * already been checked with cborParser::validate().
+ */
+bool bind_cbor(const uint8_t       *cbor,
+               size_t               cborLength,
+               const ConfigSection  sections[],
+               size_t               numSections,
+               void *const          dst[])
+{
+	size_t               offset = 0;
+	cborParser::CborItem map;
+	if (cborParser::next(cbor, cborLength, &offset, &map) != 0 ||
+	    map.type != cborParser::CborType::Map)
+	{
+		return false;
+	}
+
+	char     path[JsonMaxPath];
+	uint32_t seen = 0;
+	return check_sections(sections, numSections) &&
+	       bind_map(map.data,
+	                map.size,
+	                path,
+	                0,
+	                0,
+	                sections,
+	                numSections,
+	                dst,
+	                seen) &&
+	       check_complete(sections, numSections, seen);
+}
+
+/**
+ * Check and fill in the destination structs from a document in
+ * either JSON or CBOR.
+ */
+bool bind_config(const void          *src,
+                 size_t               srcLength,
+                 const ConfigSection  sections[],
+                 size_t               numSections,
+                 void *const          dst[])
+{
+	if (is_cbor(src, srcLength))
+	{
+		auto cbor = static_cast<const uint8_t *>(src);
+		if (cborParser::validate(cbor, srcLength) != 0)
+		{
+			Debug::log("thread {} Invalid CBOR", thread_id_get());
+			return false;
+		}
+		return bind_cbor(cbor, srcLength, sections, numSections, dst);
+	}
+
+	auto json = static_cast<const char *>(src);
+	if (jsonParser::validate(json, srcLength) != JSONSuccess)
+	{
+		Debug::log("thread {} Invalid JSON {}",
+		           thread_id_get(),
+		           std::string_view{json, srcLength});
+		return false;
+	}
+	return bind_json(json, srcLength, sections, numSections, dst);
+}
+
+/**
+ * Fill in several destination structs.
+ */
+template<size_t N>
+bool bind_json(const char *json,
+               size_t      jsonLength,
+               const ConfigSection (&sections)[N],
+               void *const dst[])
+{
+	return bind_json(json, jsonLength, sections, N, dst);
+}
+
+template<size_t N>
+bool bind_config(const void *src,
+                 size_t      srcLength,
+                 const ConfigSection (&sections)[N],
+                 void *const dst[])
+{
+	return bind_config(src, srcLength, sections, N, dst);
+}
+
+/**
+ * Fill in a single destination struct from its schema.
+ */
+template<typename Schema>
+bool bind_json(const char *json, size_t jsonLength, void *dst)
+{
+	static constexpr ConfigSection Sections[] = {config_section<Schema>()};
+	void *const                    dsts[]     = {dst};
+	return bind_json(json, jsonLength, Sections, 1, dsts);
+}
+
+/**
+ * Parse a JSON or CBOR document, or a compiled blob, into an item
+ * using its schema.
+ */
+template<typename Schema>
+int parse_json_config(const void *src, void *dst)
+{
+	static constexpr ConfigSection Sections[] = {config_section<Schema>()};
+	void *const                    dsts[]     = {dst};
+
+	if (CHERI::Capability{dst}.bounds() < sizeof(typename Schema::Type))
+	{
+		Debug::log("Invalid size for {}", sizeof(typename Schema::Type));
+		return -1;
+	}
+
+	// A blob compiled offline only needs its fields checking
+	size_t srcLength = CHERI::Capability{src}.bounds();
+	if (is_config_blob(src, srcLength))
+	{
+		return parse_blob_config<Schema>(src, dst);
+	}
+
+	// Populate the config struct in a single pass over the document
+	bool parsed = bind_config(src, srcLength, Sections, dsts);
+
+	return (parsed) ? 0 : -1;
+}
+
+/**
+ * Define a parser callback called name for an item which is provided
+ * as JSON (or CBOR).
+ */
+#define DEFINE_JSON_CONFIG_PARSER(name, Schema)                                \
+	int __cheri_callback name(const void *src, void *dst)                      \
+	{                                                                          \
+		return parse_json_config<Schema>(src, dst);                            \
+	}
@@ -0,0 +1,109 @@
+// Copyright Configured Things Ltd and CHERIoT Contributors.
+// SPDX-License-Identifier: MIT
+
+/**
+ * Code to run inside a sandbox compartment to parse a single
+ * JSON document describing the state of all of the LEDs into
+ * both the RGB LED and User LED configuration items.
+ *
+ * The document has the form
+ *
+ *   {"rgb":  {"led0": {"red": 0, "green": 0, "blue": 0},
+ *             "led1": {"red": 0, "green": 0, "blue": 0}},
+ *    "user": {"leds": ["on", ... "off"]}}
+ *
+ * or the equivalent in CBOR.
+ *
+ * The broker calls the parser once with a buffer for each
+ * output, and commits both of them together if it succeeds.
+ */
+
+/**
+ * As with the individual LED parsers, block heap operations
+ */
+#define CHERIOT_NO_AMBIENT_MALLOC
+#define CHERIOT_NO_NEW_DELETE
+
+#include <compartment.h>
+#include <cstdlib>
+#include <debug.hh>
+#include <string.h>
+#include <thread.h>
+
+// Expose debugging features unconditionally for this compartment.
+using Debug = ConditionalDebug<true, "LED Parser">;
+
+#include "config/parser_helper.h"
+
+// Set for Items we are allowed to register a parser for
+#include "common/config_broker/config_broker.h"
+
+#include "config/include/rgb_led.h"
+#include "config/include/user_led.h"
+
+#define LED_CONFIG "led"
+// The document is parsed in a single pass, so limiting its size also
+// limits how long the parser can hold the provider's thread, with the
+// cycles as a backstop.
+DEFINE_PARSER_CONFIG_CAPABILITY_WITH_BUDGET(LED_CONFIG, 0, 1800, 1024, 400000);
+
+#define RGB_LED_CONFIG "rgb_led"
+DEFINE_SCHEMA_PARSER_CONFIG_CAPABILITY(RGB_LED_CONFIG, rgbLed::Schema, 1800);
+
+#define USER_LED_CONFIG "user_led"
+DEFINE_SCHEMA_PARSER_CONFIG_CAPABILITY(USER_LED_CONFIG, userLed::Schema, 1800);
+
+/**
+ * Sections of the JSON document.  The RGB LED config is the first
+ * output and the User LED config the second.
+ */
+static constexpr ConfigSection LedSections[] = {
+  config_section<rgbLed::Schema>("rgb"),
+  config_section<userLed::Schema>("user"),
+};
+
+/**
+ * Parse a json string into both an RGB LED and a User LED Config
+ * struct.  The order of dst matches the outputs passed to
+ * set_multi_parser().
+ */
+int __cheri_callback parse_LED_config(const void *src,
+                                      void       *dst[],
+                                      size_t      numDst)
+{
+	if (numDst != 2)
+	{
+		return -1;
+	}
+
+	// Check the document (JSON or CBOR) once for both items and
+	// populate the config structs in a single pass over it
+	bool parsed =
+	  bind_config(src, CHERI::Capability{src}.bounds(), LedSections, dst);
+
+	return (parsed) ? 0 : -1;
+}
+
+/**
+ * Register the parser with the Broker. This needs to be
+ * run before any values can be accepted.
+ */
+int __cheri_compartment("parser_led") parse_led_init()
+{
+	ConfigCapability outputs[] = {
+	  PARSER_CONFIG_CAPABILITY(RGB_LED_CONFIG),
+	  PARSER_CONFIG_CAPABILITY(USER_LED_CONFIG),
+	};
+
+	auto res = set_multi_parser(PARSER_CONFIG_CAPABILITY(LED_CONFIG),
+	                            outputs,
+	                            sizeof(outputs) / sizeof(outputs[0]),
+	                            parse_LED_config);
+
+	if (res < 0)
+	{
+		Debug::log("Failed to register parser for led");
+	}
+
+	return res;
+}
@@ -0,0 +1,129 @@
+// Copyright Configured Things Ltd and CHERIoT Contributors.
+// SPDX-License-Identifier: MIT
+
+/**
+ * Code to run inside a sandbox compartment to compute the derived
+ * LED state item from the RGB LED and User LED configuration.
+ *
+ * As with a parser there must be
+ *   * A sealed capability granting permission to define the
+ *     derived item, and giving its size.
+ *   * Read capabilities for each of the inputs.
+ *   * A callback which computes the value from the inputs.
+ */
+
+/**
+ * Block heap operations
+ */
+#define CHERIOT_NO_AMBIENT_MALLOC
+#define CHERIOT_NO_NEW_DELETE
+
+#include <compartment.h>
+#include <cstdlib>
+#include <debug.hh>
+#include <string.h>
+
+// Expose debugging features unconditionally for this compartment.
+using Debug = ConditionalDebug<true, "LED State">;
+
+#include "common/config_broker/config_broker.h"
+
+#include "config/include/led_state.h"
+#include "config/include/rgb_led.h"
+#include "config/include/user_led.h"
+
+#define LED_STATE_CONFIG "led_state"
+DEFINE_DERIVED_CONFIG_CAPABILITY(LED_STATE_CONFIG, sizeof(ledState::Config));
+
+#define RGB_LED_CONFIG "rgb_led"
+DEFINE_READ_CONFIG_CAPABILITY(RGB_LED_CONFIG)
+
+#define USER_LED_CONFIG "user_led"
+DEFINE_READ_CONFIG_CAPABILITY(USER_LED_CONFIG)
+
+namespace
+{
+	/**
+	 * Check an input is either not yet set or large enough for its
+	 * config struct.
+	 */
+	template<typename T>
+	bool valid_input(const void *input)
+	{
+		return (input == nullptr) ||
+		       (CHERI::Capability{input}.bounds() >= sizeof(T));
+	}
+
+} // namespace
+
+/**
+ * Count the LEDs that are lit.  An input that hasn't been set yet
+ * counts as all off.
+ */
+int __cheri_callback compute_led_state(const void *inputs[],
+                                       size_t      numInputs,
+                                       void       *dst)
+{
+	if (numInputs != 2 || !valid_input<rgbLed::Config>(inputs[0]) ||
+	    !valid_input<userLed::Config>(inputs[1]))
+	{
+		Debug::log("Invalid inputs for {}", LED_STATE_CONFIG);
+		return -1;
+	}
+
+	ledState::Config state = {0, 0};
+
+	if (inputs[0] != nullptr)
+	{
+		rgbLed::Config rgb;
+		memcpy(&rgb, inputs[0], sizeof(rgb));
+		const rgbLed::Colour leds[] = {rgb.led0, rgb.led1};
+		for (auto &led : leds)
+		{
+			if (led.red != 0 || led.green != 0 || led.blue != 0)
+			{
+				state.rgbOn++;
+			}
+		}
+	}
+
+	if (inputs[1] != nullptr)
+	{
+		userLed::Config user;
+		memcpy(&user, inputs[1], sizeof(user));
+		for (auto led : user.leds)
+		{
+			if (led == userLed::State::On)
+			{
+				state.userOn++;
+			}
+		}
+	}
+
+	memcpy(dst, &state, sizeof(state));
+	return 0;
+}
+
+/**
+ * Define the derived item with the Broker.  Like the parsers this
+ * is called from the parser_init compartment.
+ */
+int __cheri_compartment("parser_led_state") parse_led_state_init()
+{
+	ReadConfigCapability inputs[] = {
+	  READ_CONFIG_CAPABILITY(RGB_LED_CONFIG),
+	  READ_CONFIG_CAPABILITY(USER_LED_CONFIG),
+	};
+
+	auto res = set_derived(DERIVED_CONFIG_CAPABILITY(LED_STATE_CONFIG),
+	                       inputs,
+	                       sizeof(inputs) / sizeof(inputs[0]),
+	                       compute_led_state);
+
+	if (res < 0)
+	{
+		Debug::log("Failed to define derived item for led state");
+	}
+
+	return res;
+}
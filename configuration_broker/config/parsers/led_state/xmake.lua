@@ -0,0 +1,9 @@
+-- Copyright Configured Things Ltd and CHERIoT Contributors.
+-- SPDX-License-Identifier: MIT
+
+
+-- Sandbox to compute the derived LED state
+compartment("parser_led_state")
+    set_default(false)
+    add_includedirs("../../..")
+    add_files("parser.cc")
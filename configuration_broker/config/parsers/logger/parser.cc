@@ -11,6 +11,9 @@
  *     the parser, and defining some key characteristics.
  *   * A callback which will perform the parse, typically using
  *     the collection of helper functions in parser_helper.h
+ *
+ * The logger config is provided as a struct rather than JSON, so
+ * the parser only has to check each field against the schema.
  */
 
 /**
@@ -30,83 +33,22 @@ using Debug = ConditionalDebug<true, "Logger Parser">;
 
 // Set for Items we are allowed to register a parser for
 #include "common/config_broker/config_broker.h"
+#include "config/schema_parser.h"
 
 #include "config/include/logger.h"
 #define LOGGER_CONFIG "logger"
-DEFINE_PARSER_CONFIG_CAPABILITY(LOGGER_CONFIG, sizeof(logger::Config), 500);
-
-namespace
-{
+DEFINE_SCHEMA_PARSER_CONFIG_CAPABILITY(LOGGER_CONFIG, logger::Schema, 500);
 
-	bool isaddr(char c)
-	{
-		return ((c == '.') || (c >= '0' && c <= '9'));
-	}
+// Log warnings to the local host until we get a value from a provider
+DEFINE_CONFIG_DEFAULT(LOGGER_CONFIG,
+                      logger::Config,
+                      {{"127.0.0.1", 514}, logger::logLevel::Warn});
 
-} // namespace
 /**
- * Parse a LoggerConfig struct.
+ * Parse a LoggerConfig struct, with the fields given by the schema
+ * in config/include/logger.h
  */
-int __cheri_callback parse_logger_config(const void *src, void *dst)
-{
-	auto *config    = static_cast<logger::Config *>(dst);
-	auto *srcConfig = static_cast<const logger::Config *>(src);
-	bool  parsed    = true;
-
-	// Check the kind is in range
-	switch (srcConfig->level)
-	{
-		case logger::logLevel::Debug:
-		case logger::logLevel::Info:
-		case logger::logLevel::Warn:
-		case logger::logLevel::Error:
-			config->level = srcConfig->level;
-			break;
-
-		default:
-			Debug::log("thread {} Invalid logLevel {}",
-			           thread_id_get(),
-			           srcConfig->level);
-			parsed = false;
-			break;
-	}
-
-	// Check the host address
-	for (auto i = 0; i < sizeof(config->host.address); i++)
-	{
-		auto c = srcConfig->host.address[i];
-
-		if (c == 0)
-		{
-			config->host.address[i] = c;
-			break;
-		}
-		if (!isaddr(c))
-		{
-			Debug::log("Invalid character {} in host.address", c);
-			parsed = false;
-			break;
-		}
-		else
-		{
-			config->host.address[i] = c;
-		}
-	}
-
-	// check the port.  As its defined to be a uint_16 any
-	// value i svalide, apart form 0 which is reserved
-	if (srcConfig->host.port > 0)
-	{
-		config->host.port = srcConfig->host.port;
-	}
-	else
-	{
-		Debug::log("Invalid host.port {}", srcConfig->host.port);
-		parsed = false;
-	}
-
-	return (parsed) ? 0 : -1;
-}
+DEFINE_STRUCT_CONFIG_PARSER(parse_logger_config, logger::Schema)
 
 /**
  * Register the parser with the Broker. This needs to be
@@ -119,8 +61,9 @@ int __cheri_callback parse_logger_config(const void *src, void *dst)
  */
 int __cheri_compartment("parser_logger") parse_logger_init()
 {
-	auto res =
-	  set_parser(PARSER_CONFIG_CAPABILITY(LOGGER_CONFIG), parse_logger_config);
+	auto res = set_parser(PARSER_CONFIG_CAPABILITY(LOGGER_CONFIG),
+	                      parse_logger_config,
+	                      CONFIG_DEFAULT(LOGGER_CONFIG));
 
 	if (res < 0)
 	{
@@ -0,0 +1,118 @@
+// Copyright Configured Things Ltd and CHERIoT Contributors.
+// SPDX-License-Identifier: MIT
+
+/**
+ * Code to run inside a sandbox compartment to parse the items
+ * used by the broker stress benchmark.  These are passed as raw
+ * structs so the parser only has to check the size, which keeps
+ * the cost of the parser out of the measurements.
+ */
+#define CHERIOT_NO_AMBIENT_MALLOC
+#define CHERIOT_NO_NEW_DELETE
+
+#include <compartment.h>
+#include <debug.hh>
+#include <string.h>
+
+// Expose debugging features unconditionally for this compartment.
+using Debug = ConditionalDebug<true, "Parser">;
+
+// Set for Items we are allowed to register a parser for
+#include "common/config_broker/config_broker.h"
+
+#include "config/include/stress.h"
+
+// No minimum interval between updates, as the point is to
+// load the broker as heavily as possible.
+#define STRESS_0 "stress/0"
+#define STRESS_1 "stress/1"
+#define STRESS_2 "stress/2"
+#define STRESS_3 "stress/3"
+#define STRESS_4 "stress/4"
+#define STRESS_5 "stress/5"
+#define STRESS_6 "stress/6"
+#define STRESS_7 "stress/7"
+DEFINE_PARSER_CONFIG_CAPABILITY(STRESS_0, sizeof(stress::Value), 0);
+DEFINE_PARSER_CONFIG_CAPABILITY(STRESS_1, sizeof(stress::Value), 0);
+DEFINE_PARSER_CONFIG_CAPABILITY(STRESS_2, sizeof(stress::Value), 0);
+DEFINE_PARSER_CONFIG_CAPABILITY(STRESS_3, sizeof(stress::Value), 0);
+DEFINE_PARSER_CONFIG_CAPABILITY(STRESS_4, sizeof(stress::Value), 0);
+DEFINE_PARSER_CONFIG_CAPABILITY(STRESS_5, sizeof(stress::Value), 0);
+DEFINE_PARSER_CONFIG_CAPABILITY(STRESS_6, sizeof(stress::Value), 0);
+DEFINE_PARSER_CONFIG_CAPABILITY(STRESS_7, sizeof(stress::Value), 0);
+
+// A large item that the broker holds compressed
+#define STRESS_TABLE "stress_table"
+DEFINE_COMPRESSED_PARSER_CONFIG_CAPABILITY(STRESS_TABLE,
+                                           sizeof(stress::Table),
+                                           0);
+
+/**
+ * Copy a raw stress::Value, checking only that it is the right size.
+ */
+int __cheri_callback parse_stress_value(const void *src, void *dst)
+{
+	CHERI::Capability srcCap = {src};
+	if (srcCap.bounds() != sizeof(stress::Value))
+	{
+		Debug::log("Invalid stress value length {}", srcCap.bounds());
+		return -1;
+	}
+
+	memcpy(dst, src, sizeof(stress::Value));
+	return 0;
+}
+
+/**
+ * Copy a raw stress::Table, checking only that it is the right size.
+ */
+int __cheri_callback parse_stress_table(const void *src, void *dst)
+{
+	CHERI::Capability srcCap = {src};
+	if (srcCap.bounds() != sizeof(stress::Table))
+	{
+		Debug::log("Invalid stress table length {}", srcCap.bounds());
+		return -1;
+	}
+
+	memcpy(dst, src, sizeof(stress::Table));
+	return 0;
+}
+
+/**
+ * Register the parser with the Broker for each of the stress items.
+ */
+int __cheri_compartment("parser_stress") parse_stress_init()
+{
+	ConfigCapability caps[] = {
+	  PARSER_CONFIG_CAPABILITY(STRESS_0),
+	  PARSER_CONFIG_CAPABILITY(STRESS_1),
+	  PARSER_CONFIG_CAPABILITY(STRESS_2),
+	  PARSER_CONFIG_CAPABILITY(STRESS_3),
+	  PARSER_CONFIG_CAPABILITY(STRESS_4),
+	  PARSER_CONFIG_CAPABILITY(STRESS_5),
+	  PARSER_CONFIG_CAPABILITY(STRESS_6),
+	  PARSER_CONFIG_CAPABILITY(STRESS_7),
+	};
+	static_assert(sizeof(caps) / sizeof(caps[0]) == stress::NumItems);
+
+	for (auto cap : caps)
+	{
+		auto res = set_parser(cap, parse_stress_value);
+		if (res < 0)
+		{
+			Debug::log("Failed to register parser for {}", cap);
+			return res;
+		}
+	}
+
+	auto res =
+	  set_parser(PARSER_CONFIG_CAPABILITY(STRESS_TABLE), parse_stress_table);
+	if (res < 0)
+	{
+		Debug::log("Failed to register parser for {}", STRESS_TABLE);
+		return res;
+	}
+
+	return 0;
+}
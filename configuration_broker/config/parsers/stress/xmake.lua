@@ -0,0 +1,9 @@
+-- Copyright Configured Things Ltd and CHERIoT Contributors.
+-- SPDX-License-Identifier: MIT
+
+
+-- Parser for the stress benchmark items
+compartment("parser_stress")
+    set_default(false)
+    add_includedirs("../../..")
+    add_files("parser.cc")
@@ -11,6 +11,9 @@
  *     the parser, and defining some key characteristics.
  *   * A callback which will perform the parse, typically using
  *     the collection of helper functions in parser_helper.h
+ *
+ * The system config is provided as a struct rather than JSON, so
+ * the parser only has to check each field against the schema.
  */
 
 #define CHERIOT_NO_AMBIENT_MALLOC
@@ -18,7 +21,6 @@
 
 #include <compartment.h>
 #include <cstdlib>
-#include <ctype.h>
 #include <debug.hh>
 #include <string.h>
 #include <thread.h>
@@ -28,63 +30,19 @@ using Debug = ConditionalDebug<true, "System Config Parser">;
 
 // Set for Items we are allowed to register a parser for
 #include "common/config_broker/config_broker.h"
+#include "config/schema_parser.h"
 
 #include "config/include/system_config.h"
 #define SYSTEM_CONFIG "system"
-DEFINE_PARSER_CONFIG_CAPABILITY(SYSTEM_CONFIG,
-                                sizeof(systemConfig::Config),
-                                500);
-
-namespace
-{
-
-	bool is_valid_char(char c)
-	{
-		return ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
-		        (c >= '0' && c <= '9') || (c == '-') || (c == '_'));
-	}
-
-} // namespace
+DEFINE_SCHEMA_PARSER_CONFIG_CAPABILITY(SYSTEM_CONFIG,
+                                       systemConfig::Schema,
+                                       500);
 
 /**
- * Parse a json string into a LoggerConfig struct.
+ * Parse a system Config struct, with the fields given by the schema
+ * in config/include/system_config.h
  */
-int __cheri_callback parse_system_config(const void *src, void *dst)
-{
-	auto *config    = static_cast<systemConfig::Config *>(dst);
-	auto *srcConfig = static_cast<const systemConfig::Config *>(src);
-	bool  parsed    = true;
-
-	// Check we have a valid id name
-	for (auto i = 0; i < sizeof(config->id); i++)
-	{
-		auto c = srcConfig->id[i];
-
-		if (c == 0)
-		{
-			config->id[i] = c;
-			break;
-		}
-		if (!is_valid_char(c))
-		{
-			Debug::log("Invalid character {} in group", c);
-			parsed = false;
-			break;
-		}
-		else
-		{
-			config->id[i] = c;
-		}
-	}
-
-	// Copy the switch settings
-	for (auto i = 0; i < sizeof(config->switches); i++)
-	{
-		config->switches[i] = srcConfig->switches[i];
-	}
-
-	return (parsed) ? 0 : -1;
-}
+DEFINE_STRUCT_CONFIG_PARSER(parse_system_config, systemConfig::Schema)
 
 /**
  * Register the parser with the Broker. This needs to be
@@ -0,0 +1,259 @@
+// Copyright Configured Things Ltd and CHERIoT Contributors.
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <cheri.hh>
+#include <compartment.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "include/schema.h"
+
+/**
+ *
+ * Parsers generated from the schema of a config item (see
+ * config/include/schema.h).  This file covers items which are
+ * provided as the config struct itself, where the parser only
+ * has to check each field; config/parser_helper.h adds the
+ * equivalent for items provided as JSON.  For example:
+ *
+ *   DEFINE_SCHEMA_PARSER_CONFIG_CAPABILITY(LOGGER_CONFIG,
+ *                                          logger::Schema,
+ *                                          500);
+ *   DEFINE_STRUCT_CONFIG_PARSER(parse_logger_config, logger::Schema)
+ *
+ * Items provided as JSON can also be compiled offline into a blob
+ * holding the struct, see parse_blob_config().
+ *
+ * Neither needs any heap, and the size the broker allocates for
+ * the item is taken from the schema so the two can't disagree.
+ *
+ */
+
+/**
+ * Define the capability to register a parser for an item, with the
+ * size of the item taken from its schema.  Like the macros in
+ * config_broker.h the symbol is pasted here so name is not expanded.
+ */
+#define DEFINE_SCHEMA_PARSER_CONFIG_CAPABILITY(name, Schema, UpdateInterval)   \
+	__DEFINE_PARSER_CONFIG_CAPABILITY(__parser_config_capability_##name,      \
+	                                  name,                                    \
+	                                  sizeof(Schema::Type),                    \
+	                                  UpdateInterval,                          \
+	                                  0,                                       \
+	                                  0,                                       \
+	                                  0)
+
+/**
+ * As above, for an item provided as JSON or CBOR where the broker
+ * should limit the size of the input and discard a parse that takes
+ * too long (see DEFINE_PARSER_CONFIG_CAPABILITY_WITH_BUDGET).
+ */
+#define DEFINE_SCHEMA_PARSER_CONFIG_CAPABILITY_WITH_BUDGET(                    \
+  name, Schema, UpdateInterval, MaxInput, ParseBudget)                         \
+	__DEFINE_PARSER_CONFIG_CAPABILITY(__parser_config_capability_##name,      \
+	                                  name,                                    \
+	                                  sizeof(Schema::Type),                    \
+	                                  UpdateInterval,                          \
+	                                  0,                                       \
+	                                  MaxInput,                                \
+	                                  ParseBudget)
+
+/**
+ * Read a number field, sign extending it if needed.
+ */
+inline int64_t config_field_number(const ConfigField &f, const void *field)
+{
+	auto p = static_cast<const uint8_t *>(field);
+	switch (f.size)
+	{
+		case 1:
+			return f.isSigned ? static_cast<int8_t>(p[0]) : p[0];
+		case 2:
+		{
+			uint16_t v;
+			memcpy(&v, p, sizeof(v));
+			return f.isSigned ? static_cast<int16_t>(v) : v;
+		}
+		default:
+		{
+			uint32_t v;
+			memcpy(&v, p, sizeof(v));
+			return f.isSigned ? static_cast<int32_t>(v) : v;
+		}
+	}
+}
+
+/**
+ * Check a value (or one element of an array) is valid for the field.
+ */
+inline bool config_check_element(const ConfigField &f, const void *field)
+{
+	switch (f.type)
+	{
+		case ConfigFieldType::Number:
+		{
+			auto value = config_field_number(f, field);
+			if (value < f.min || value > f.max)
+			{
+				Debug::log("Value {} for {} out of range",
+				           static_cast<int32_t>(value),
+				           f.path);
+				return false;
+			}
+			break;
+		}
+
+		case ConfigFieldType::Enum:
+			break;
+
+		case ConfigFieldType::String:
+			if (memchr(field, '\0', f.size) == nullptr)
+			{
+				Debug::log("{} is not terminated", f.path);
+				return false;
+			}
+			break;
+	}
+
+	if (f.isValid != nullptr && !f.isValid(field))
+	{
+		Debug::log("Invalid value for {}", f.path);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Check the value in a field, or every element of an array field, is
+ * valid for the schema.
+ */
+inline bool config_check_field(const ConfigField &f, const void *field)
+{
+	auto element = static_cast<const uint8_t *>(field);
+	for (size_t i = 0; i < config_field_elements(f); i++, element += f.size)
+	{
+		if (!config_check_element(f, element))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Check a struct for an item against its schema, and copy it to dst
+ * if every field is valid.  Both must have room for the struct.
+ */
+template<typename Schema>
+int check_struct_config(const void *src, void *dst)
+{
+	using Type = typename Schema::Type;
+
+	// Work on a copy so the provider can't change a field once
+	// it has been checked.
+	Type value;
+	memcpy(&value, src, sizeof(Type));
+
+	bool parsed = true;
+	for (auto &f : Schema::Fields)
+	{
+		parsed &= config_check_field(
+		  f, reinterpret_cast<const uint8_t *>(&value) + f.offset);
+	}
+
+	if (parsed)
+	{
+		memcpy(dst, &value, sizeof(Type));
+	}
+	return (parsed) ? 0 : -1;
+}
+
+/**
+ * Check a struct provided for an item against its schema, and copy
+ * it to dst if every field is valid.
+ */
+template<typename Schema>
+int parse_struct_config(const void *src, void *dst)
+{
+	using Type = typename Schema::Type;
+
+	if (CHERI::Capability{src}.bounds() < sizeof(Type) ||
+	    CHERI::Capability{dst}.bounds() < sizeof(Type))
+	{
+		Debug::log("Invalid size for {}", sizeof(Type));
+		return -1;
+	}
+
+	return check_struct_config<Schema>(src, dst);
+}
+
+/**
+ * Header of a config blob, i.e. a value compiled offline by
+ * tools/config_blob.py into the layout of the struct.  The struct
+ * follows the header, and the blob is signed like any other value.
+ */
+struct ConfigBlobHeader
+{
+	uint8_t  tag;        // ConfigBlobTag
+	uint8_t  version;    // ConfigBlobVersion
+	uint16_t reserved;   // Zero
+	uint32_t schemaHash; // Schema::Hash of the layout
+};
+
+/**
+ * First byte of a config blob, which is neither valid JSON nor the
+ * start of a CBOR map.
+ */
+static constexpr uint8_t ConfigBlobTag     = 0xfe;
+static constexpr uint8_t ConfigBlobVersion = 1;
+
+inline bool is_config_blob(const void *src, size_t srcLength)
+{
+	return (srcLength > 0) &&
+	       (static_cast<const uint8_t *>(src)[0] == ConfigBlobTag);
+}
+
+/**
+ * Check a config blob was compiled for the schema, then check the
+ * struct in it like any other.  Returns -1 if the blob is for a
+ * different layout.
+ */
+template<typename Schema>
+int parse_blob_config(const void *src, void *dst)
+{
+	using Type = typename Schema::Type;
+
+	ConfigBlobHeader header;
+	if (CHERI::Capability{src}.bounds() != sizeof(header) + sizeof(Type) ||
+	    CHERI::Capability{dst}.bounds() < sizeof(Type))
+	{
+		Debug::log("Invalid size for blob of {}", sizeof(Type));
+		return -1;
+	}
+
+	memcpy(&header, src, sizeof(header));
+	if (header.tag != ConfigBlobTag || header.version != ConfigBlobVersion ||
+	    header.schemaHash != Schema::Hash)
+	{
+		Debug::log("Blob for schema {} version {}, expected {} version {}",
+		           header.schemaHash,
+		           header.version,
+		           Schema::Hash,
+		           ConfigBlobVersion);
+		return -1;
+	}
+
+	return check_struct_config<Schema>(
+	  static_cast<const uint8_t *>(src) + sizeof(header), dst);
+}
+
+/**
+ * Define a parser callback called name for an item which is provided
+ * as a struct.
+ */
+#define DEFINE_STRUCT_CONFIG_PARSER(name, Schema)                              \
+	int __cheri_callback name(const void *src, void *dst)                      \
+	{                                                                          \
+		return parse_struct_config<Schema>(src, dst);                          \
+	}
@@ -10,18 +10,23 @@
 #include <token.h>
 
 // Define a sealed capability that gives this compartment
-// read access to configuration data "logger" and "rgb_led"
+// read access to configuration data "logger", "rgb_led" and
+// the derived "led_state"
 #include "common/config_broker/config_broker.h"
 
 #define RGB_LED_CONFIG "rgb_led"
 DEFINE_READ_CONFIG_CAPABILITY(RGB_LED_CONFIG)
 
+#define LED_STATE_CONFIG "led_state"
+DEFINE_READ_CONFIG_CAPABILITY(LED_STATE_CONFIG)
+
 #define LOGGER_CONFIG "logger"
 DEFINE_READ_CONFIG_CAPABILITY(LOGGER_CONFIG)
 
 // Expose debugging features unconditionally for this compartment.
 using Debug = ConditionalDebug<true, "Consumer #1">;
 
+#include "config/include/led_state.h"
 #include "config/include/logger.h"
 #include "config/include/rgb_led.h"
 
@@ -31,38 +36,33 @@ using Debug = ConditionalDebug<true, "Consumer #1">;
 
 namespace
 {
-	static logger::Config *logger;
+	// Local copy of the logger configuration, which the consumer
+	// library updates as it changes.  This means we don't need to
+	// hold a claim on the broker's copy to use it when other config
+	// values change.
+	ConfigConsumer::Replica<logger::Config> loggerReplica;
+
+	// Bitmap the broker marks our items in as they change, so we only
+	// need to wait on a single futex however many items we track.
+	std::atomic<uint32_t> changeBits[1];
+
+	// Latency from the provider to our handlers, reported when
+	// the updates stop.
+	ConfigConsumer::Latency loggerLatency;
+	ConfigConsumer::Latency ledLatency;
+	ConfigConsumer::Latency ledStateLatency;
 
 	/**
 	 * Handle updates to the logger configuration
 	 */
 	int logger_handler(void *newConfig)
 	{
-		// Claim the config against our heap quota to ensure
-		// it remains available, as we will use it when other
-		// confog values change.
-		if (heap_claim(MALLOC_CAPABILITY, newConfig) == 0)
-		{
-			Debug::log("Failed to claim {}", newConfig);
-			return -1;
-		}
-
-		auto oldConfig = logger;
-		logger         = static_cast<logger::Config *>(newConfig);
-
 		// Process the configuration change
+		auto config = static_cast<logger::Config *>(newConfig);
 		Debug::log("Configured with host: {} port: {} level: {}",
-		           (const char *)logger->host.address,
-		           (int16_t)logger->host.port,
-		           logger->level);
-
-		// Release our claim on the old config.  Note this is a safer
-		// pattern that relasing it before we process the new value in
-		// case the processing keeps some reference to the value.
-		if (oldConfig)
-		{
-			free(oldConfig);
-		}
+		           (const char *)config->host.address,
+		           (int16_t)config->host.port,
+		           config->level);
 
 		return 0;
 	}
@@ -77,10 +77,11 @@ namespace
 		// need it for the duration of this call
 
 		// Process the configuration
-		auto config = static_cast<rgbLed::Config *>(newConfig);
-		if (logger)
+		auto           config = static_cast<rgbLed::Config *>(newConfig);
+		logger::Config loggerConfig;
+		if (loggerReplica.get(loggerConfig) != 0)
 		{
-			if (logger->level == logger::logLevel::Debug)
+			if (loggerConfig.level == logger::logLevel::Debug)
 			{
 				Debug::log("LED 0 red: {} green: {} blue: {}",
 				           config->led0.red,
@@ -96,6 +97,17 @@ namespace
 		return 0;
 	}
 
+	/**
+	 * Handle updates to the LED state, which the broker computes
+	 * from the RGB LED and User LED configuration.
+	 */
+	int led_state_handler(void *newConfig)
+	{
+		auto config = static_cast<ledState::Config *>(newConfig);
+		Debug::log("LEDs lit: {} RGB, {} user", config->rgbOn, config->userOn);
+		return 0;
+	}
+
 } // namespace
 
 /**
@@ -107,11 +119,32 @@ void __cheri_compartment("consumer1") init()
 {
 	/// List of configuration items we are tracking
 	ConfigConsumer::ConfigItem configItems[] = {
-	  {READ_CONFIG_CAPABILITY(LOGGER_CONFIG), logger_handler, 0, nullptr},
-	  {READ_CONFIG_CAPABILITY(RGB_LED_CONFIG), led_handler, 0, nullptr},
+	  {.capability   = READ_CONFIG_CAPABILITY(LOGGER_CONFIG),
+	   .handler      = logger_handler,
+	   .version      = 0,
+	   .versionFutex = nullptr,
+	   .replica      = &loggerReplica,
+	   .latency      = &loggerLatency},
+	  {.capability   = READ_CONFIG_CAPABILITY(RGB_LED_CONFIG),
+	   .handler      = led_handler,
+	   .version      = 0,
+	   .versionFutex = nullptr,
+	   .latency      = &ledLatency},
+	  {.capability   = READ_CONFIG_CAPABILITY(LED_STATE_CONFIG),
+	   .handler      = led_state_handler,
+	   .version      = 0,
+	   .versionFutex = nullptr,
+	   .latency      = &ledStateLatency},
 	};
 
 	size_t numOfItems = sizeof(configItems) / sizeof(configItems[0]);
 
-	ConfigConsumer::run(configItems, numOfItems, MAX_CONFIG_TIMEOUTS);
+	ConfigConsumer::RunOptions options;
+	options.maxTimeouts = MAX_CONFIG_TIMEOUTS;
+	options.changeBits  = changeBits;
+	ConfigConsumer::run(configItems, numOfItems, options);
+
+	loggerLatency.log<Debug>(LOGGER_CONFIG);
+	ledLatency.log<Debug>(RGB_LED_CONFIG);
+	ledStateLatency.log<Debug>(LED_STATE_CONFIG);
 }
@@ -29,6 +29,10 @@ using Debug = ConditionalDebug<true, "Consumer #2">;
 
 namespace
 {
+	// Latency from the provider to our handlers, reported when
+	// the updates stop.
+	ConfigConsumer::Latency loggerLatency;
+	ConfigConsumer::Latency userLedLatency;
 
 	static logger::Config *logger;
 
@@ -77,15 +81,10 @@ namespace
 		{
 			if (logger->level == logger::logLevel::Debug)
 			{
-				Debug::log("User LEDs: {} {} {} {} {} {} {} {}",
-				           config->led0,
-				           config->led1,
-				           config->led2,
-				           config->led3,
-				           config->led4,
-				           config->led5,
-				           config->led6,
-				           config->led7);
+				for (size_t i = 0; i < userLed::NumLeds; i++)
+				{
+					Debug::log("User LED {}: {}", i, config->leds[i]);
+				}
 			}
 		}
 
@@ -103,16 +102,25 @@ void __cheri_compartment("consumer2") init()
 {
 	// List of configuration items we are tracking
 	ConfigConsumer::ConfigItem configItems[] = {
-	  {
-	    READ_CONFIG_CAPABILITY(LOGGER_CONFIG),
-	    logger_handler,
-	    0,
-	    nullptr,
-	  },
-	  {READ_CONFIG_CAPABILITY(USER_LED_CONFIG), user_led_handler, 0, nullptr},
+	  {.capability   = READ_CONFIG_CAPABILITY(LOGGER_CONFIG),
+	   .handler      = logger_handler,
+	   .version      = 0,
+	   .versionFutex = nullptr,
+	   .latency      = &loggerLatency},
+	  {.capability   = READ_CONFIG_CAPABILITY(USER_LED_CONFIG),
+	   .handler      = user_led_handler,
+	   .version      = 0,
+	   .versionFutex = nullptr,
+	   .latency      = &userLedLatency},
 	};
 
 	size_t numOfItems = sizeof(configItems) / sizeof(configItems[0]);
 
-	ConfigConsumer::run(configItems, numOfItems, MAX_CONFIG_TIMEOUTS);
+	// Use push mode so the broker sends us each new value via a
+	// message queue, coalescing any burst of updates.
+	ConfigConsumer::run_push(
+	  configItems, numOfItems, numOfItems * 2, true, MAX_CONFIG_TIMEOUTS);
+
+	loggerLatency.log<Debug>(LOGGER_CONFIG);
+	userLedLatency.log<Debug>(USER_LED_CONFIG);
 }
@@ -20,6 +20,8 @@ using Debug = ConditionalDebug<true, "Parser Init">;
 int __cheri_compartment("parser_rgb_led") parse_rgb_led_init();
 int __cheri_compartment("parser_user_led") parse_user_led_init();
 int __cheri_compartment("parser_logger") parse_logger_init();
+int __cheri_compartment("parser_led") parse_led_init();
+int __cheri_compartment("parser_led_state") parse_led_state_init();
 
 // Next step after initalisation
 int __cheri_compartment("provider") provider_run();
@@ -29,6 +31,8 @@ void __cheri_compartment("parser_init") parser_init()
 	auto res = parse_rgb_led_init();
 	res      = std::min(res, parse_user_led_init());
 	res      = std::min(res, parse_logger_init());
+	res      = std::min(res, parse_led_init());
+	res      = std::min(res, parse_led_state_init());
 
 	if (res == 0)
 	{
@@ -0,0 +1,201 @@
+// Copyright Configured Things Ltd and CHERIoT Contributors.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config/include/logger.h"
+#include "config/include/system_config.h"
+
+//
+// Payloads for the parser benchmark.  Each parser has a corpus of
+// valid payloads, invalid ones that a well behaved provider might
+// still send, and adversarial ones intended to make the parser work
+// as hard as possible before it rejects them.
+//
+// The large adversarial JSON documents and the compiled blobs are
+// generated by the benchmark at startup, see parser_bench.cc.
+//
+
+namespace parserBench
+{
+
+	/// Whether a parser is expected to accept a payload.
+	enum Expect : bool
+	{
+		Reject = false,
+		Accept = true,
+	};
+
+	struct Payload
+	{
+		const char *name;
+		const void *data;
+		size_t      length;
+		Expect      expect;
+	};
+
+	/// A JSON or CBOR document given as a string literal.
+#define BENCH_DOCUMENT(name, expect, text)                                     \
+	Payload                                                                    \
+	{                                                                          \
+		name, text, sizeof(text) - 1, expect                                   \
+	}
+
+	/// A struct value, as provided for the logger and system config.
+#define BENCH_STRUCT(name, expect, value)                                      \
+	Payload                                                                    \
+	{                                                                          \
+		name, &value, sizeof(value), expect                                    \
+	}
+
+	/// Size of the buffers for generated documents.  This is a multiple
+	/// of the capability alignment so the bounds can be set exactly.
+	static constexpr size_t GeneratedLength = 1536;
+
+	// Generated documents, filled in by the benchmark
+	inline char DeepNesting[GeneratedLength];
+	inline char LongString[GeneratedLength];
+	inline char ManyKeys[GeneratedLength];
+	inline char LongNumber[GeneratedLength];
+
+	// Compiled blobs, filled in by the benchmark
+	inline uint8_t RgbLedBlob[8 + 6];
+	inline uint8_t UserLedBlob[8 + 32];
+
+	/// Adversarial JSON documents shared by the JSON parsers.
+#define BENCH_GENERATED_DOCUMENTS                                              \
+	Payload{"deep nesting", DeepNesting, GeneratedLength, Reject},             \
+	  Payload{"long string", LongString, GeneratedLength, Reject},             \
+	  Payload{"many keys", ManyKeys, GeneratedLength, Reject},                 \
+	  Payload{"long number", LongNumber, GeneratedLength, Reject}
+
+	inline const Payload RgbLedCorpus[] = {
+	  BENCH_DOCUMENT("json",
+	                 Accept,
+	                 R"({"led0":{"red":255,"green":128,"blue":0},)"
+	                 R"("led1":{"red":0,"green":64,"blue":32}})"),
+	  BENCH_DOCUMENT("json reordered",
+	                 Accept,
+	                 R"({"led1":{"blue":32,"green":64,"red":0},)"
+	                 R"("led0":{"blue":0,"green":128,"red":255}})"),
+	  BENCH_DOCUMENT("cbor",
+	                 Accept,
+	                 "\xa2\x64led0\xa3\x63red\x18\xff\x65green\x18\x80"
+	                 "\x64"
+	                 "blue\x00\x64led1\xa3\x63red\x00\x65green\x18\x40"
+	                 "\x64"
+	                 "blue\x18\x20"),
+	  Payload{"blob", RgbLedBlob, sizeof(RgbLedBlob), Accept},
+	  BENCH_DOCUMENT("out of range",
+	                 Reject,
+	                 R"({"led0":{"red":256,"green":128,"blue":0},)"
+	                 R"("led1":{"red":0,"green":64,"blue":32}})"),
+	  BENCH_DOCUMENT("missing field",
+	                 Reject,
+	                 R"({"led0":{"red":255,"green":128,"blue":0},)"
+	                 R"("led1":{"red":0,"green":64}})"),
+	  BENCH_DOCUMENT("wrong type",
+	                 Reject,
+	                 R"({"led0":{"red":"255","green":128,"blue":0},)"
+	                 R"("led1":{"red":0,"green":64,"blue":32}})"),
+	  BENCH_DOCUMENT("truncated",
+	                 Reject,
+	                 R"({"led0":{"red":255,"green":128,"blue":0},)"
+	                 R"("led1":{"red":0,"green":64,"blue":)"),
+	  BENCH_DOCUMENT("duplicate key",
+	                 Reject,
+	                 R"({"led0":{"red":255,"red":255,"red":255,"red":255,)"
+	                 R"("green":128,"blue":0},)"
+	                 R"("led1":{"red":0,"green":64,"blue":32}})"),
+	  BENCH_GENERATED_DOCUMENTS,
+	};
+
+	inline const Payload UserLedCorpus[] = {
+	  BENCH_DOCUMENT("json",
+	                 Accept,
+	                 R"({"leds":["on","off","on","off",)"
+	                 R"("on","off","on","off"]})"),
+	  BENCH_DOCUMENT("cbor",
+	                 Accept,
+	                 "\xa1\x64leds\x88\x62on\x63off\x62on\x63off"
+	                 "\x62on\x63off\x62on\x63off"),
+	  BENCH_DOCUMENT("cbor by value",
+	                 Accept,
+	                 "\xa1\x64leds\x88\x01\x00\x01\x00\x01\x00\x01\x00"),
+	  BENCH_DOCUMENT("cbor unknown value",
+	                 Reject,
+	                 "\xa1\x64leds\x88\x01\x00\x01\x00\x01\x00\x01\x07"),
+	  Payload{"blob", UserLedBlob, sizeof(UserLedBlob), Accept},
+	  BENCH_DOCUMENT("unknown state",
+	                 Reject,
+	                 R"({"leds":["on","off","on","off",)"
+	                 R"("on","off","on","dim"]})"),
+	  BENCH_DOCUMENT("too few values",
+	                 Reject,
+	                 R"({"leds":["on","off","on","off",)"
+	                 R"("on","off","on"]})"),
+	  BENCH_DOCUMENT("too many values",
+	                 Reject,
+	                 R"({"leds":["on","off","on","off",)"
+	                 R"("on","off","on","off","on"]})"),
+	  BENCH_DOCUMENT("not an array", Reject, R"({"leds":"on"})"),
+	  BENCH_DOCUMENT("not an object", Reject, R"(["on","off","on","off"])"),
+	  BENCH_GENERATED_DOCUMENTS,
+	};
+
+	inline const logger::Config LoggerValid = {{"192.168.1.10", 514},
+	                                           logger::logLevel::Info};
+	inline const logger::Config LoggerPortZero = {{"192.168.1.10", 0},
+	                                              logger::logLevel::Info};
+	inline const logger::Config LoggerBadAddress = {{"logs.example", 514},
+	                                                logger::logLevel::Info};
+	inline const logger::Config LoggerBadLevel = {
+	  {"192.168.1.10", 514},
+	  static_cast<logger::logLevel>(7)};
+	inline const logger::Config LoggerUnterminated = {
+	  {{'1', '9', '2', '.', '1', '6', '8', '.', '1', '.', '1', '0', '.', '1',
+	    '0', '0'},
+	   514},
+	  logger::logLevel::Info};
+
+	inline const Payload LoggerCorpus[] = {
+	  BENCH_STRUCT("struct", Accept, LoggerValid),
+	  BENCH_STRUCT("port zero", Reject, LoggerPortZero),
+	  BENCH_STRUCT("bad address", Reject, LoggerBadAddress),
+	  BENCH_STRUCT("bad level", Reject, LoggerBadLevel),
+	  BENCH_STRUCT("unterminated", Reject, LoggerUnterminated),
+	  Payload{"short", &LoggerValid, sizeof(LoggerValid) - 1, Reject},
+	};
+
+	inline const systemConfig::Config SystemValid = {
+	  "ghdyeosp_1",
+	  {true, false, false, false, false, false, false, false}};
+	inline const systemConfig::Config SystemBadId = {"ghdy/eosp_1", {}};
+	inline const systemConfig::Config SystemUnterminated = {
+	  {'a', 'a', 'a', 'a', 'a', 'a', 'a', 'a', 'a', 'a', 'a', 'a', 'a', 'a',
+	   'a', 'a'},
+	  {}};
+
+	/// The system config with the switches as bytes, so that one can
+	/// hold a value that isn't a valid bool.
+	struct SystemBytes
+	{
+		char    id[systemConfig::IdLength];
+		uint8_t switches[8];
+	};
+	static_assert(sizeof(SystemBytes) == sizeof(systemConfig::Config));
+	inline const SystemBytes SystemBadSwitch = {"ghdyeosp_1",
+	                                            {1, 0, 2, 0, 0, 0, 0, 0}};
+
+	inline const Payload SystemConfigCorpus[] = {
+	  BENCH_STRUCT("struct", Accept, SystemValid),
+	  BENCH_STRUCT("bad id", Reject, SystemBadId),
+	  BENCH_STRUCT("unterminated", Reject, SystemUnterminated),
+	  BENCH_STRUCT("bad switch", Reject, SystemBadSwitch),
+	  Payload{"short", &SystemValid, sizeof(SystemValid) - 1, Reject},
+	};
+
+} // namespace parserBench
@@ -0,0 +1,9 @@
+// Copyright Configured Things Ltd and CHERIoT Contributors.
+// SPDX-License-Identifier: MIT
+#pragma once
+
+// Host stand-ins for the CHERIoT calling convention attributes,
+// which have no meaning outside a compartment.
+#define __cheri_compartment(name)
+#define __cheri_libcall
+#define __cheri_callback
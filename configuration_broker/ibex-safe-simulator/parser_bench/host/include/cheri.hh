@@ -0,0 +1,73 @@
+// Copyright Configured Things Ltd and CHERIoT Contributors.
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <map>
+#include <stddef.h>
+
+namespace CHERI
+{
+
+	namespace host
+	{
+		/**
+		 * Bounds set on pointers, by address.  A host pointer
+		 * carries no bounds, so the harness sets them on each buffer
+		 * it passes to a parser and they are looked up here.
+		 */
+		inline std::map<const void *, size_t> bounds;
+	} // namespace host
+
+	/**
+	 * Host stand-in for a capability, supporting only reading and
+	 * setting its bounds.  A pointer without bounds set has a length
+	 * of zero.
+	 */
+	template<typename T>
+	class Capability
+	{
+		T *ptr;
+
+		class BoundsProxy
+		{
+			const void *ptr;
+
+			public:
+			BoundsProxy(const void *p) : ptr(p) {}
+
+			operator size_t() const
+			{
+				auto b = host::bounds.find(ptr);
+				return (b == host::bounds.end()) ? 0 : b->second;
+			}
+
+			BoundsProxy &operator=(size_t length)
+			{
+				host::bounds[ptr] = length;
+				return *this;
+			}
+		};
+
+		public:
+		Capability(T *p) : ptr(p) {}
+
+		BoundsProxy bounds()
+		{
+			return {ptr};
+		}
+
+		T *get() const
+		{
+			return ptr;
+		}
+
+		operator T *() const
+		{
+			return ptr;
+		}
+	};
+
+	template<typename T>
+	Capability(T *) -> Capability<T>;
+
+} // namespace CHERI
@@ -0,0 +1,99 @@
+// Copyright Configured Things Ltd and CHERIoT Contributors.
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <algorithm>
+#include <stdint.h>
+#include <stdio.h>
+#include <string_view>
+#include <type_traits>
+
+/**
+ * Host stand-in for the CHERIoT debug API, printing to stdout.
+ */
+template<size_t N>
+struct DebugContext
+{
+	char name[N];
+
+	constexpr DebugContext(const char (&s)[N])
+	{
+		std::copy_n(s, N, name);
+	}
+};
+
+namespace host
+{
+	inline void debug_print(const char *s)
+	{
+		fputs(s, stdout);
+	}
+
+	inline void debug_print(std::string_view s)
+	{
+		fwrite(s.data(), 1, s.size(), stdout);
+	}
+
+	inline void debug_print(char c)
+	{
+		putchar(c);
+	}
+
+	inline void debug_print(bool b)
+	{
+		fputs(b ? "true" : "false", stdout);
+	}
+
+	inline void debug_print(const void *p)
+	{
+		printf("%p", p);
+	}
+
+	template<typename T>
+	    requires std::is_integral_v<T>
+	void debug_print(T v)
+	{
+		if constexpr (std::is_signed_v<T>)
+		{
+			printf("%lld", static_cast<long long>(v));
+		}
+		else
+		{
+			printf("%llu", static_cast<unsigned long long>(v));
+		}
+	}
+
+	template<typename T>
+	    requires std::is_enum_v<T>
+	void debug_print(T v)
+	{
+		debug_print(static_cast<std::underlying_type_t<T>>(v));
+	}
+} // namespace host
+
+template<bool Enabled, DebugContext Context>
+struct ConditionalDebug
+{
+	template<typename... Args>
+	static void log(const char *format, Args... args)
+	{
+		if constexpr (Enabled)
+		{
+			printf("%s: ", Context.name);
+			auto next = [&](auto arg) {
+				for (; *format != '\0'; format++)
+				{
+					if (format[0] == '{' && format[1] == '}')
+					{
+						format += 2;
+						host::debug_print(arg);
+						return;
+					}
+					putchar(*format);
+				}
+			};
+			(next(args), ...);
+			printf("%s\n", format);
+		}
+	}
+};
@@ -0,0 +1,24 @@
+// Copyright Configured Things Ltd and CHERIoT Contributors.
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <chrono>
+#include <stdint.h>
+#if defined(__x86_64__) || defined(__i386__)
+#	include <x86intrin.h>
+#endif
+
+/**
+ * Host stand-in for the cycle counter.  Uses the time stamp counter
+ * where there is one, and nanoseconds otherwise.
+ */
+static inline uint64_t rdcycle64()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+	         std::chrono::steady_clock::now().time_since_epoch())
+	  .count();
+#endif
+}
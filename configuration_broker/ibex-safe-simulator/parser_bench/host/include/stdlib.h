@@ -0,0 +1,26 @@
+// Copyright Configured Things Ltd and CHERIoT Contributors.
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include_next <stdlib.h>
+
+#include <sys/types.h>
+
+/**
+ * Host stand-ins for the parts of the CHERIoT heap API used by the
+ * benchmark.  Code built for the host allocates from the system
+ * heap, which has no quota, so the quota never changes and
+ * heap_free_all() has nothing to free.
+ */
+typedef void *AllocatorCapability;
+#define MALLOC_CAPABILITY (static_cast<AllocatorCapability>(nullptr))
+
+static inline ssize_t heap_quota_remaining(AllocatorCapability)
+{
+	return 4096;
+}
+
+static inline ssize_t heap_free_all(AllocatorCapability)
+{
+	return 0;
+}
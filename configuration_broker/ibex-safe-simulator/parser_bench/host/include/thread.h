@@ -0,0 +1,12 @@
+// Copyright Configured Things Ltd and CHERIoT Contributors.
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <cdefs.h>
+
+#include <stdint.h>
+
+static inline uint16_t thread_id_get()
+{
+	return 0;
+}
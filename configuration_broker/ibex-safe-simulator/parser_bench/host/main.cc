@@ -0,0 +1,12 @@
+// Copyright Configured Things Ltd and CHERIoT Contributors.
+// SPDX-License-Identifier: MIT
+
+// Host entry point for the parser benchmark
+
+void parser_bench_run();
+
+int main()
+{
+	parser_bench_run();
+	return 0;
+}
@@ -0,0 +1,29 @@
+-- Copyright Configured Things Ltd and CHERIoT Contributors.
+-- SPDX-License-Identifier: MIT
+
+-- Host build of the parser benchmark, for quick iteration on the
+-- parsers without the simulator.  Build and run with
+--   xmake -P .
+--   xmake run -P . parser-bench-host
+
+set_project("CHERIoT Config Parser Benchmark (host)")
+set_languages("c++20")
+
+option("parser-bench-iterations")
+    set_default("10000")
+    set_description("Number of times the parser benchmark parses each payload")
+
+target("parser-bench-host")
+    set_kind("binary")
+    -- Stand-ins for the CHERIoT headers come first
+    add_includedirs("include", "../../..")
+    add_files("main.cc", "../parser_bench.cc")
+    add_files("../../../../third_party/json_parser/json_parser.cc",
+              "../../../../third_party/json_parser/coreJSON/core_json.cc",
+              "../../../../third_party/cbor_parser/cbor_parser.cc")
+    add_forceincludes("cdefs.h")
+
+    on_load(function(target)
+        target:add('options', "parser-bench-iterations")
+        target:add("defines", "PARSER_BENCH_ITERATIONS=" .. tostring(get_config("parser-bench-iterations")))
+    end)
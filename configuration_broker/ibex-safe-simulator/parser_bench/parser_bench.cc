@@ -0,0 +1,267 @@
+// Copyright Configured Things Ltd and CHERIoT Contributors.
+// SPDX-License-Identifier: MIT
+
+#include <algorithm>
+#include <compartment.h>
+#include <debug.hh>
+#include <riscvreg.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The parsers log each value they reject, which would swamp both the
+// output and the timings, so they get a disabled Debug and the results
+// are reported through Report.
+using Debug  = ConditionalDebug<false, "Parser Bench">;
+using Report = ConditionalDebug<true, "Parser Bench">;
+
+#include "common/config_consumer/histogram.h"
+#include "config/parser_helper.h"
+
+#include "config/include/logger.h"
+#include "config/include/rgb_led.h"
+#include "config/include/system_config.h"
+#include "config/include/user_led.h"
+
+#include "corpus.h"
+
+//
+// Benchmark of the cost of the parsers.  Each payload in the corpus
+// for a parser is parsed PARSER_BENCH_ITERATIONS times, and we report
+// the cycles per parse, the heap quota used by a parse, and how often
+// that made us call heap_free_all() as the parsers used to.
+//
+// The parsers are instantiated here from the same schemas and
+// templates as in their sandboxes (see config/parsers), so they run
+// in this compartment and any heap they use comes from its quota.
+// The same code is built for the host by host/xmake.lua for quicker
+// iteration, where the cycles come from the host's time stamp counter.
+//
+
+namespace
+{
+	using ConfigConsumer::Histogram;
+	using parserBench::Payload;
+
+	struct Parser
+	{
+		const char *name;
+		int (*parse)(const void *src, void *dst);
+		size_t         size; // Size of the config struct
+		const Payload *corpus;
+		size_t         corpusLength;
+	};
+
+	template<size_t N>
+	constexpr Parser parser(const char *name,
+	                        int (*parse)(const void *, void *),
+	                        size_t size,
+	                        const Payload (&corpus)[N])
+	{
+		return {name, parse, size, corpus, N};
+	}
+
+	const Parser Parsers[] = {
+	  parser("parse_RGB_LED_config",
+	         parse_json_config<rgbLed::Schema>,
+	         sizeof(rgbLed::Config),
+	         parserBench::RgbLedCorpus),
+	  parser("parse_User_LED_config",
+	         parse_json_config<userLed::Schema>,
+	         sizeof(userLed::Config),
+	         parserBench::UserLedCorpus),
+	  parser("parse_logger_config",
+	         parse_struct_config<logger::Schema>,
+	         sizeof(logger::Config),
+	         parserBench::LoggerCorpus),
+	  parser("parse_system_config",
+	         parse_struct_config<systemConfig::Schema>,
+	         sizeof(systemConfig::Config),
+	         parserBench::SystemConfigCorpus),
+	};
+
+	// Buffers for the payload and the result of each parse.  Bounds
+	// are set on these to the length of each, as the broker would.
+	alignas(16) uint8_t srcBuffer[parserBench::GeneratedLength];
+	alignas(16) uint8_t dstBuffer[64];
+
+	Histogram cycles;
+
+	/**
+	 * Fill a generated document with spaces, so its length is fixed,
+	 * and then write the JSON at the start.
+	 */
+	template<typename Fill>
+	void generate(char *buffer, Fill &&fill)
+	{
+		memset(buffer, ' ', parserBench::GeneratedLength);
+		fill(buffer, parserBench::GeneratedLength - 1);
+	}
+
+	void generate_documents()
+	{
+		// Objects nested as deeply as will fit
+		generate(parserBench::DeepNesting, [](char *p, size_t space) {
+			size_t depth = space / 6;
+			for (size_t i = 0; i < depth; i++)
+			{
+				memcpy(p, "{\"a\":", 5);
+				p += 5;
+			}
+			*p++ = '0';
+			memset(p, '}', depth);
+		});
+
+		// A value which is one very long string
+		generate(parserBench::LongString, [](char *p, size_t space) {
+			memcpy(p, "{\"led0\":\"", 9);
+			memset(p + 9, 'x', space - 11);
+			memcpy(p + space - 2, "\"}", 2);
+		});
+
+		// Lots of keys the schema doesn't know about
+		generate(parserBench::ManyKeys, [](char *p, size_t space) {
+			auto *end = p + space - 6;
+			*p++      = '{';
+			for (unsigned i = 0; end - p > 10; i++)
+			{
+				*p++ = '"';
+				*p++ = 'k';
+				for (unsigned d = 1000; d > 0; d /= 10)
+				{
+					*p++ = '0' + (i / d) % 10;
+				}
+				memcpy(p, "\":0,", 4);
+				p += 4;
+			}
+			memcpy(p, "\"k\":0}", 6);
+		});
+
+		// A number with more digits than any integer type
+		generate(parserBench::LongNumber, [](char *p, size_t space) {
+			memcpy(p, "{\"led0\":{\"red\":", 15);
+			memset(p + 15, '9', space - 17);
+			memcpy(p + space - 2, "}}", 2);
+		});
+	}
+
+	/**
+	 * Compile a blob for a value, as tools/config_blob.py would.
+	 */
+	template<typename Schema, size_t N>
+	void generate_blob(uint8_t (&blob)[N], const typename Schema::Type &value)
+	{
+		static_assert(N == sizeof(ConfigBlobHeader) + sizeof(value));
+		ConfigBlobHeader header = {
+		  ConfigBlobTag, ConfigBlobVersion, 0, Schema::Hash};
+		memcpy(blob, &header, sizeof(header));
+		memcpy(blob + sizeof(header), &value, sizeof(value));
+	}
+
+	void generate_blobs()
+	{
+		using enum userLed::State;
+		generate_blob<rgbLed::Schema>(parserBench::RgbLedBlob,
+		                              {{255, 128, 0}, {0, 64, 32}});
+		generate_blob<userLed::Schema>(
+		  parserBench::UserLedBlob, {{On, Off, On, Off, On, Off, On, Off}});
+	}
+
+	/**
+	 * Counts for one parser across its corpus.
+	 */
+	struct Totals
+	{
+		uint32_t accepted;
+		uint32_t rejected;
+		uint32_t unexpected;
+		uint32_t heapFrees;
+	};
+
+	/**
+	 * Parse a payload PARSER_BENCH_ITERATIONS times and report the
+	 * results.
+	 */
+	void run(const Parser &p, const Payload &payload, Totals &totals)
+	{
+		memcpy(srcBuffer, payload.data, payload.length);
+		CHERI::Capability src{static_cast<const void *>(srcBuffer)};
+		src.bounds() = payload.length;
+		CHERI::Capability dst{static_cast<void *>(dstBuffer)};
+		dst.bounds() = p.size;
+
+		cycles            = {};
+		int      result   = 0;
+		ssize_t  heapUsed = 0;
+		uint32_t heapFree = 0;
+		for (size_t i = 0; i < PARSER_BENCH_ITERATIONS; i++)
+		{
+			auto quota = heap_quota_remaining(MALLOC_CAPABILITY);
+			auto start = rdcycle64();
+			result     = p.parse(src.get(), dst.get());
+			cycles.record(rdcycle64() - start);
+
+			// As the parsers used to, only walk the heap with
+			// heap_free_all() if the quota shows something leaked.
+			auto used = quota - heap_quota_remaining(MALLOC_CAPABILITY);
+			if (used > 0)
+			{
+				heapUsed = std::max(heapUsed, used);
+				heap_free_all(MALLOC_CAPABILITY);
+				heapFree++;
+			}
+		}
+
+		bool accepted = (result == 0);
+		accepted ? totals.accepted++ : totals.rejected++;
+		totals.heapFrees += heapFree;
+		if (accepted != payload.expect)
+		{
+			totals.unexpected++;
+		}
+
+		Report::log("{} {} ({} bytes): {}{}, p50 {} p99 {} cycles, "
+		            "heap used {}, heap_free_all {}",
+		            p.name,
+		            payload.name,
+		            payload.length,
+		            accepted ? "accepted" : "rejected",
+		            (accepted != payload.expect) ? " (unexpected)" : "",
+		            static_cast<uint32_t>(cycles.percentile(50)),
+		            static_cast<uint32_t>(cycles.percentile(99)),
+		            static_cast<int32_t>(heapUsed),
+		            heapFree);
+	}
+
+} // namespace
+
+/**
+ * Thread entry point.  Runs each parser over its corpus and reports
+ * the results.
+ */
+void __cheri_compartment("parser_bench") parser_bench_run()
+{
+	generate_documents();
+	generate_blobs();
+
+	Report::log("Running each payload {} times", PARSER_BENCH_ITERATIONS);
+
+	uint32_t unexpected = 0;
+	for (auto &p : Parsers)
+	{
+		Totals totals = {};
+		for (size_t i = 0; i < p.corpusLength; i++)
+		{
+			run(p, p.corpus[i], totals);
+		}
+		Report::log("{}: {} accepted, {} rejected, {} unexpected, "
+		            "heap_free_all {}",
+		            p.name,
+		            totals.accepted,
+		            totals.rejected,
+		            totals.unexpected,
+		            totals.heapFrees);
+		unexpected += totals.unexpected;
+	}
+
+	Report::log("Done, {} unexpected results", unexpected);
+}
@@ -0,0 +1,17 @@
+-- Copyright Configured Things Ltd and CHERIoT Contributors.
+-- SPDX-License-Identifier: MIT
+
+option("parser-bench-iterations")
+    set_default("100")
+    set_description("Number of times the parser benchmark parses each payload")
+
+-- Parser benchmark compartment
+compartment("parser_bench")
+    set_default(false)
+    add_includedirs("../..")
+    add_files("parser_bench.cc")
+
+    on_load(function(target)
+        target:add('options', "parser-bench-iterations")
+        target:add("defines", "PARSER_BENCH_ITERATIONS=" .. tostring(get_config("parser-bench-iterations")))
+    end)
@@ -26,17 +26,20 @@
  *   led1: {red: 200, green: 200, blue: 200},
  * }
  *
+ * topic: led
+ * ----------
+ * {
+ *   rgb: {
+ *     led0: {red: 100, green: 100, blue: 100},
+ *     led1: {red: 200, green: 200, blue: 200}
+ *   },
+ *   user: {leds: ['on', 'off', ... 'On']}
+ * }
+ *
  * topic: userled
  * --------------
  * {
- *   led0: 'on',
- *   led1: 'off',
- *   led2: 'ON',
- *   led3: 'OFF',
- *   led4: 'Off',
- *   led5: 'On',
- *   led6: 'off',
- *   led7: 'On'
+ *   leds: ['on', 'off', 'ON', 'OFF', 'Off', 'On', 'off', 'On']
  * }
  *
  */
@@ -92,18 +95,28 @@ namespace
 	  {"Valid User LED config",
 	   0,
 	   "userled",
-	   "{\"led0\":\"on\",\"led1\":\"off\",\"led2\":\"ON\",\"led3\":\"OFF\","
-	   " \"led4\":\"On\",\"led5\":\"Off\",\"led6\":\"on\",\"led7\":\"off\"}"},
+	   "{\"leds\":[\"on\",\"off\",\"ON\",\"OFF\","
+	   "          \"On\",\"Off\",\"on\",\"off\"]}"},
 
 	  // Invalid RGB LED config - invalid Json
 	  {"InvalidRBG LED config (bad JSON)", -EINVAL, "rgbled", "{\"x\":"},
 
+	  // Valid combined LED config, which updates both the RGB
+	  // and User LEDs from one message
+	  {"Valid combined LED config",
+	   0,
+	   "led",
+	   "{\"rgb\":{\"led0\":{\"red\":10,\"green\":20,\"blue\":30},"
+	   "         \"led1\":{\"red\":40,\"green\":50,\"blue\":60}},"
+	   " \"user\":{\"leds\":[\"on\",\"on\",\"off\",\"off\","
+	   "                  \"on\",\"on\",\"off\",\"off\"]}}"},
+
 	  // Valid User LED config
 	  {"Valid User LED config",
 	   0,
 	   "userled",
-	   "{\"led0\":\"OFF\",\"led1\":\"ON\",\"led2\":\"off\",\"led3\":\"on\","
-	   " \"led4\":\"Off\",\"led5\":\"On\",\"led6\":\"off\",\"led7\":\"on\"}"},
+	   "{\"leds\":[\"OFF\",\"ON\",\"off\",\"on\","
+	   "          \"Off\",\"On\",\"off\",\"on\"]}"},
 
 	  // Valid RGB LED config
 	  {"Valid RGB LED config",
@@ -116,8 +129,8 @@ namespace
 	  {"Valid User LED config",
 	   0,
 	   "userled",
-	   "{\"led0\":\"OFF\",\"led1\":\"ON\",\"led2\":\"off\",\"led3\":\"on\","
-	   " \"led4\":\"Off\",\"led5\":\"On\",\"led6\":\"off\",\"led7\":\"on\"}"},
+	   "{\"leds\":[\"OFF\",\"ON\",\"off\",\"on\","
+	   "          \"Off\",\"On\",\"off\",\"on\"]}"},
 
 	  // Invalid RGB LED config
 	  {"Invalid RGB LED config",
@@ -126,6 +139,14 @@ namespace
 	   "{\"led0\":{\"red\":0,  \"green\":286,\"blue\":400},"
 	   " \"led1\":{\"red\":255,\"green\":200,\"blue\":200}}"},
 
+	  // Invalid combined LED config, which updates neither
+	  {"Invalid combined LED config",
+	   -EINVAL,
+	   "led",
+	   "{\"rgb\":{\"led0\":{\"red\":10,\"green\":20,\"blue\":30},"
+	   "         \"led1\":{\"red\":40,\"green\":50,\"blue\":60}},"
+	   " \"user\":{\"leds\":[\"dim\"]}}"},
+
 	};
 
 } // namespace
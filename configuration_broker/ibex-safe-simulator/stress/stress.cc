@@ -0,0 +1,497 @@
+// Copyright Configured Things Ltd and CHERIoT Contributors.
+// SPDX-License-Identifier: MIT
+
+#include <atomic>
+#include <compartment.h>
+#include <cstdlib>
+#include <debug.hh>
+#include <fail-simulator-on-error.h>
+#include <futex.h>
+#include <riscvreg.h>
+#include <string.h>
+#include <thread.h>
+#include <tick_macros.h>
+#include <token.h>
+
+#include "common/config_broker/config_broker.h"
+#include "common/config_consumer/histogram.h"
+#include "config/include/stress.h"
+
+// Expose debugging features unconditionally for this compartment.
+using Debug = ConditionalDebug<true, "Stress">;
+
+//
+// Benchmark to measure the throughput and latency of the broker
+// under load.  A coordinator thread registers the parser and then
+// releases STRESS_WRITERS writer threads, which call set_config()
+// on the stress items in turn, STRESS_READERS reader threads,
+// which call get_config() and wait on the version futex of the items,
+// and a prefix reader which reads all of the items under "stress" at
+// once and waits on the futex of the prefix.
+// After STRESS_DURATION_MS the coordinator stops them and reports
+// the results.
+//
+// Each thread records its latencies in its own histogram, so
+// the only contention is in the broker.
+//
+// Before the run the coordinator also sets a table which the broker
+// holds compressed, and reads it back with read_config_into().
+//
+
+#define STRESS_0 "stress/0"
+#define STRESS_1 "stress/1"
+#define STRESS_2 "stress/2"
+#define STRESS_3 "stress/3"
+#define STRESS_4 "stress/4"
+#define STRESS_5 "stress/5"
+#define STRESS_6 "stress/6"
+#define STRESS_7 "stress/7"
+DEFINE_WRITE_CONFIG_CAPABILITY(STRESS_0)
+DEFINE_WRITE_CONFIG_CAPABILITY(STRESS_1)
+DEFINE_WRITE_CONFIG_CAPABILITY(STRESS_2)
+DEFINE_WRITE_CONFIG_CAPABILITY(STRESS_3)
+DEFINE_WRITE_CONFIG_CAPABILITY(STRESS_4)
+DEFINE_WRITE_CONFIG_CAPABILITY(STRESS_5)
+DEFINE_WRITE_CONFIG_CAPABILITY(STRESS_6)
+DEFINE_WRITE_CONFIG_CAPABILITY(STRESS_7)
+DEFINE_READ_CONFIG_CAPABILITY(STRESS_0)
+DEFINE_READ_CONFIG_CAPABILITY(STRESS_1)
+DEFINE_READ_CONFIG_CAPABILITY(STRESS_2)
+DEFINE_READ_CONFIG_CAPABILITY(STRESS_3)
+DEFINE_READ_CONFIG_CAPABILITY(STRESS_4)
+DEFINE_READ_CONFIG_CAPABILITY(STRESS_5)
+DEFINE_READ_CONFIG_CAPABILITY(STRESS_6)
+DEFINE_READ_CONFIG_CAPABILITY(STRESS_7)
+
+#define STRESS_PREFIX "stress"
+DEFINE_READ_CONFIG_PREFIX_CAPABILITY(STRESS_PREFIX)
+
+#define STRESS_TABLE "stress_table"
+DEFINE_WRITE_CONFIG_CAPABILITY(STRESS_TABLE)
+DEFINE_READ_CONFIG_CAPABILITY(STRESS_TABLE)
+
+int __cheri_compartment("parser_stress") parse_stress_init();
+
+namespace
+{
+	using ConfigConsumer::Histogram;
+
+	/// Results for one writer thread.
+	struct WriterResults
+	{
+		Histogram set;    // set_config() latency
+		uint32_t  errors; // set_config() failures
+	};
+
+	/// Results for one reader thread.
+	struct ReaderResults
+	{
+		Histogram get;         // get_config() latency
+		Histogram propagation; // From set_config() to the reader seeing it
+		uint32_t  waits;       // Futex waits
+		uint32_t  wakes;       // Futex waits that ended with a new version
+	};
+
+	/// Results for the prefix reader thread.
+	struct PrefixResults
+	{
+		Histogram get;    // get_config_prefix() latency
+		uint32_t  errors; // get_config_prefix() failures
+		uint32_t  items;  // Items under the prefix in the last read
+		uint32_t  waits;  // Futex waits
+		uint32_t  wakes;  // Futex waits that ended with a new version
+	};
+
+	WriterResults writerResults[STRESS_WRITERS];
+	ReaderResults readerResults[STRESS_READERS];
+	PrefixResults prefixResults;
+
+	/// Number of worker threads, including the prefix reader.
+	static constexpr uint32_t NumWorkers = STRESS_WRITERS + STRESS_READERS + 1;
+
+	/// State of the run, used as a futex to start the workers.
+	enum Phase : uint32_t
+	{
+		Waiting,
+		Running,
+		Stopped,
+	};
+	std::atomic<uint32_t> phase;
+
+	/// Used to give each worker its own results.
+	std::atomic<uint32_t> nextWriter;
+	std::atomic<uint32_t> nextReader;
+
+	/// Count of workers that have finished, used as a futex.
+	std::atomic<uint32_t> finished;
+
+	WriteConfigCapability write_capability(size_t i)
+	{
+		switch (i)
+		{
+			case 0:
+				return WRITE_CONFIG_CAPABILITY(STRESS_0);
+			case 1:
+				return WRITE_CONFIG_CAPABILITY(STRESS_1);
+			case 2:
+				return WRITE_CONFIG_CAPABILITY(STRESS_2);
+			case 3:
+				return WRITE_CONFIG_CAPABILITY(STRESS_3);
+			case 4:
+				return WRITE_CONFIG_CAPABILITY(STRESS_4);
+			case 5:
+				return WRITE_CONFIG_CAPABILITY(STRESS_5);
+			case 6:
+				return WRITE_CONFIG_CAPABILITY(STRESS_6);
+			default:
+				return WRITE_CONFIG_CAPABILITY(STRESS_7);
+		}
+	}
+
+	ReadConfigCapability read_capability(size_t i)
+	{
+		switch (i)
+		{
+			case 0:
+				return READ_CONFIG_CAPABILITY(STRESS_0);
+			case 1:
+				return READ_CONFIG_CAPABILITY(STRESS_1);
+			case 2:
+				return READ_CONFIG_CAPABILITY(STRESS_2);
+			case 3:
+				return READ_CONFIG_CAPABILITY(STRESS_3);
+			case 4:
+				return READ_CONFIG_CAPABILITY(STRESS_4);
+			case 5:
+				return READ_CONFIG_CAPABILITY(STRESS_5);
+			case 6:
+				return READ_CONFIG_CAPABILITY(STRESS_6);
+			default:
+				return READ_CONFIG_CAPABILITY(STRESS_7);
+		}
+	}
+
+	/// Wait for the coordinator to start the run.
+	void wait_for_start()
+	{
+		while (phase.load() == Waiting)
+		{
+			phase.wait(Waiting);
+		}
+	}
+
+	/// Tell the coordinator this worker has finished.
+	void worker_finished()
+	{
+		finished++;
+		finished.notify_all();
+	}
+
+	uint64_t ticks_now()
+	{
+		auto tick = thread_systemtick_get();
+		return (static_cast<uint64_t>(tick.hi) << 32) + tick.lo;
+	}
+
+	/**
+	 * Set the compressed table, read it back and check it is
+	 * unchanged.  The table has runs of equal entries so that it
+	 * compresses well.
+	 */
+	void check_table()
+	{
+		// Static to keep them off the coordinator's stack
+		static stress::Table table;
+		static stress::Table copy;
+		table.sequence = 1;
+		for (size_t i = 0; i < stress::TableEntries; i++)
+		{
+			table.entries[i] = static_cast<uint8_t>(i / 16);
+		}
+
+		auto start = rdcycle64();
+		auto res   = set_config(
+		  WRITE_CONFIG_CAPABILITY(STRESS_TABLE), &table, sizeof(table));
+		auto setCycles = rdcycle64() - start;
+		if (res != 0)
+		{
+			Debug::log("Failed to set {}: {}", STRESS_TABLE, res);
+			return;
+		}
+
+		uint32_t version;
+		start = rdcycle64();
+		res   = read_config_into(
+		  READ_CONFIG_CAPABILITY(STRESS_TABLE), &copy, sizeof(copy), &version);
+		auto readCycles = rdcycle64() - start;
+		if (res != static_cast<int>(sizeof(copy)) ||
+		    memcmp(&copy, &table, sizeof(copy)) != 0)
+		{
+			Debug::log("Failed to read back {}: {}", STRESS_TABLE, res);
+			return;
+		}
+
+		Debug::log("{} version {}: set_config {} cycles, read_config_into {} "
+		           "cycles",
+		           STRESS_TABLE,
+		           version,
+		           static_cast<uint32_t>(setCycles),
+		           static_cast<uint32_t>(readCycles));
+	}
+
+	void report(const char *name, const Histogram &h, uint64_t elapsedMs)
+	{
+		Debug::log("{}: {} ops, {} ops/s, p50 {} cycles, p99 {} cycles",
+		           name,
+		           h.count,
+		           static_cast<uint32_t>(
+		             elapsedMs ? (static_cast<uint64_t>(h.count) * 1000) /
+		                           elapsedMs
+		                       : 0),
+		           static_cast<uint32_t>(h.percentile(50)),
+		           static_cast<uint32_t>(h.percentile(99)));
+	}
+
+} // namespace
+
+/**
+ * Writer thread entry point.  Sets each of the items in turn
+ * as fast as the broker will accept them.
+ */
+void __cheri_compartment("stress") stress_writer()
+{
+	auto id = nextWriter++;
+	if (id >= STRESS_WRITERS)
+	{
+		Debug::log("More writer threads than STRESS_WRITERS");
+		return;
+	}
+	auto &results = writerResults[id];
+
+	wait_for_start();
+
+	stress::Value value = {id, 0, 0};
+	while (phase.load() == Running)
+	{
+		auto cap = write_capability((id + value.sequence) % stress::NumItems);
+		value.written = rdcycle64();
+		auto res      = set_config(cap, &value, sizeof(value));
+		results.set.record(rdcycle64() - value.written);
+		if (res != 0)
+		{
+			results.errors++;
+		}
+		value.sequence++;
+	}
+
+	worker_finished();
+}
+
+/**
+ * Reader thread entry point.  Reads each of the items in turn, and if
+ * an item hasn't changed since it was last read waits briefly on its
+ * version futex.
+ */
+void __cheri_compartment("stress") stress_reader()
+{
+	auto id = nextReader++;
+	if (id >= STRESS_READERS)
+	{
+		Debug::log("More reader threads than STRESS_READERS");
+		return;
+	}
+	auto &results = readerResults[id];
+
+	uint32_t versions[stress::NumItems] = {};
+
+	wait_for_start();
+
+	size_t next = id;
+	while (phase.load() == Running)
+	{
+		auto i     = next++ % stress::NumItems;
+		auto start = rdcycle64();
+		auto item  = get_config(read_capability(i));
+		auto now   = rdcycle64();
+		results.get.record(now - start);
+
+		if (item.versionFutex == nullptr)
+		{
+			continue;
+		}
+
+		if (item.version != versions[i] && item.data != nullptr)
+		{
+			// Measure how long the new value took to reach us.  The
+			// value may be freed by the next update, so take a claim
+			// on it while we read it.
+			Timeout t{0};
+			if (heap_claim_ephemeral(&t, item.data, nullptr) == 0)
+			{
+				auto value = static_cast<const stress::Value *>(item.data);
+				results.propagation.record(now - value->written);
+			}
+			versions[i] = item.version;
+			continue;
+		}
+
+		// No change, so wait a tick for one
+		Timeout t{1};
+		results.waits++;
+		if (futex_timed_wait(&t,
+		                     reinterpret_cast<const uint32_t *>(
+		                       item.versionFutex),
+		                     item.version) == 0 &&
+		    item.versionFutex->load() != item.version)
+		{
+			results.wakes++;
+		}
+	}
+
+	worker_finished();
+}
+
+/**
+ * Prefix reader thread entry point.  Reads all of the items under the
+ * stress prefix in one call, and then waits briefly on the prefix
+ * futex for any of them to change.
+ */
+void __cheri_compartment("stress") stress_prefix_reader()
+{
+	auto &results = prefixResults;
+
+	ConfigPrefix prefix;
+	ConfigItem   items[stress::NumItems];
+
+	wait_for_start();
+
+	while (phase.load() == Running)
+	{
+		auto start = rdcycle64();
+		auto res   = get_config_prefix(
+		  READ_CONFIG_PREFIX_CAPABILITY(STRESS_PREFIX),
+		  &prefix,
+		  items,
+		  stress::NumItems);
+		results.get.record(rdcycle64() - start);
+		if (res < 0)
+		{
+			results.errors++;
+			Timeout t{1};
+			thread_sleep(&t);
+			continue;
+		}
+		results.items = res;
+
+		// Wait a tick for any of the items to change
+		Timeout t{1};
+		results.waits++;
+		if (futex_timed_wait(&t,
+		                     reinterpret_cast<const uint32_t *>(
+		                       prefix.versionFutex),
+		                     prefix.version) == 0 &&
+		    prefix.versionFutex->load() != prefix.version)
+		{
+			results.wakes++;
+		}
+	}
+
+	worker_finished();
+}
+
+/**
+ * Coordinator thread entry point.  Registers the parser, runs the
+ * workers for STRESS_DURATION_MS and then reports the results.
+ */
+void __cheri_compartment("stress") stress_run()
+{
+	if (parse_stress_init() != 0)
+	{
+		Debug::log("Failed to initialise the stress parser");
+		return;
+	}
+
+	check_table();
+
+	ConfigBrokerStats before;
+	get_config_broker_stats(&before);
+
+	Debug::log("Starting {} writers and {} readers for {} ms",
+	           STRESS_WRITERS,
+	           STRESS_READERS,
+	           STRESS_DURATION_MS);
+
+	auto startTicks = ticks_now();
+	phase           = Running;
+	phase.notify_all();
+
+	Timeout t{MS_TO_TICKS(STRESS_DURATION_MS)};
+	thread_sleep(&t, ThreadSleepNoEarlyWake);
+
+	phase = Stopped;
+	auto elapsedMs = (ticks_now() - startTicks) * MS_PER_TICK;
+
+	// Wait for each of the workers to finish their last operation
+	uint32_t done;
+	while ((done = finished.load()) < NumWorkers)
+	{
+		finished.wait(done);
+	}
+
+	ConfigBrokerStats after;
+	get_config_broker_stats(&after);
+
+	Histogram set         = {};
+	Histogram get         = {};
+	Histogram propagation = {};
+	uint32_t  errors      = 0;
+	uint32_t  waits       = 0;
+	uint32_t  wakes       = 0;
+	for (auto &w : writerResults)
+	{
+		set.add(w.set);
+		errors += w.errors;
+	}
+	for (auto &r : readerResults)
+	{
+		get.add(r.get);
+		propagation.add(r.propagation);
+		waits += r.waits;
+		wakes += r.wakes;
+	}
+
+	Debug::log("Results after {} ms", static_cast<uint32_t>(elapsedMs));
+	report("set_config", set, elapsedMs);
+	report("get_config", get, elapsedMs);
+	report("propagation", propagation, elapsedMs);
+	Debug::log("set_config errors: {}", errors);
+	Debug::log("futex waits: {} woken by a change: {}", waits, wakes);
+	report("get_config_prefix", prefixResults.get, elapsedMs);
+	Debug::log("prefix errors: {} items: {} waits: {} woken by a change: {}",
+	           prefixResults.errors,
+	           prefixResults.items,
+	           prefixResults.waits,
+	           prefixResults.wakes);
+	Debug::log("lock waits: {} lock wait cycles: {}",
+	           after.lockWaits - before.lockWaits,
+	           static_cast<uint32_t>(after.lockWaitCycles -
+	                                 before.lockWaitCycles));
+
+	for (size_t i = 0; i < stress::NumItems; i++)
+	{
+		ConfigLockStats lock;
+		if (get_config_lock_stats(read_capability(i), &lock) == 0)
+		{
+			Debug::log("item {} lock: {} acquires, {} waits, hold mean {} "
+			           "max {} cycles, max wait {} cycles (thread {} behind {})",
+			           i,
+			           lock.acquires,
+			           lock.waits,
+			           lock.meanHoldCycles,
+			           lock.maxHoldCycles,
+			           lock.maxWaitCycles,
+			           lock.maxWaitWaiter,
+			           lock.maxWaitHolder);
+		}
+	}
+}
@@ -0,0 +1,27 @@
+-- Copyright Configured Things Ltd and CHERIoT Contributors.
+-- SPDX-License-Identifier: MIT
+
+option("stress-writers")
+    set_default("4")
+    set_description("Number of writer threads in the broker stress benchmark")
+
+option("stress-readers")
+    set_default("4")
+    set_description("Number of reader threads in the broker stress benchmark")
+
+option("stress-duration")
+    set_default("5000")
+    set_description("Duration of the broker stress benchmark in mS")
+
+-- Broker stress benchmark compartment
+compartment("stress")
+    set_default(false)
+    add_includedirs("../..")
+    add_files("stress.cc")
+
+    on_load(function(target)
+        target:add('options', "stress-writers", "stress-readers", "stress-duration")
+        target:add("defines", "STRESS_WRITERS=" .. tostring(get_config("stress-writers")))
+        target:add("defines", "STRESS_READERS=" .. tostring(get_config("stress-readers")))
+        target:add("defines", "STRESS_DURATION_MS=" .. tostring(get_config("stress-duration")))
+    end)
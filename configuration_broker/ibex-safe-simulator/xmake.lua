@@ -9,13 +9,15 @@ set_toolchains("cheriot-clang")
 
 -- Support libraries
 includes(path.join(sdkdir, "lib/freestanding"),
-         path.join(sdkdir, "lib/string"))
+         path.join(sdkdir, "lib/string"),
+         path.join(sdkdir, "lib/queue"))
 
 option("board")
     set_default("ibex-safe-simulator")
 
 -- Common libraries and compartments
 includes("../../third_party/json_parser")
+includes("../../third_party/cbor_parser")
 includes("../common/config_broker") 
 includes("../common/config_consumer")
 
@@ -29,16 +31,28 @@ includes("provider")
 includes("../config/parsers/rgb_led")
 includes("../config/parsers/user_led")
 includes("../config/parsers/logger")
+includes("../config/parsers/led")
+
+-- Sandbox to compute the derived LED state
+includes("../config/parsers/led_state")
 
 -- Consumers
 includes("consumers")
 
+-- Broker stress benchmark
+includes("stress")
+includes("../config/parsers/stress")
+
+-- Parser benchmark
+includes("parser_bench")
+
 -- Firmware image for the example.
 firmware("config-broker-ibex-sim")
     add_deps("freestanding", "debug", "string")
 
     -- libraries
     add_deps("json_parser")
+    add_deps("cbor_parser")
     add_deps("config_consumer")
     
     -- compartments
@@ -48,6 +62,8 @@ firmware("config-broker-ibex-sim")
     add_deps("parser_logger")
     add_deps("parser_rgb_led")
     add_deps("parser_user_led")
+    add_deps("parser_led")
+    add_deps("parser_led_state")
     add_deps("consumer1")
     add_deps("consumer2")
     on_load(function(target)
@@ -84,4 +100,89 @@ firmware("config-broker-ibex-sim")
         }, {expand = false})
     end)
 
+-- Firmware image for the broker stress benchmark.  This is not built
+-- by default, and the number of threads can be set with
+--   xmake config --stress-writers=<n> --stress-readers=<m>
+firmware("config-broker-ibex-stress")
+    set_default(false)
+    add_deps("freestanding", "debug", "string")
 
+    -- compartments
+    add_deps("config_broker")
+    add_deps("parser_stress")
+    add_deps("stress")
+    on_load(function(target)
+        target:values_set("board", "$(board)")
+        local threads = {
+            {
+                -- Thread to register the parser, start and stop
+                -- the workers, and report the results.  This has
+                -- the highest priority so it can stop the run.
+                compartment = "stress",
+                priority = 3,
+                entry_point = "stress_run",
+                stack_size = 0x600,
+                trusted_stack_frames = 4
+            },
+        }
+        for i = 1, tonumber(get_config("stress-writers")) do
+            -- Threads to set config values
+            table.insert(threads, {
+                compartment = "stress",
+                priority = 2,
+                entry_point = "stress_writer",
+                stack_size = 0x500,
+                trusted_stack_frames = 4
+            })
+        end
+        for i = 1, tonumber(get_config("stress-readers")) do
+            -- Threads to read and wait for config values
+            table.insert(threads, {
+                compartment = "stress",
+                priority = 2,
+                entry_point = "stress_reader",
+                stack_size = 0x500,
+                trusted_stack_frames = 3
+            })
+        end
+        -- Thread to read all of the items under the prefix
+        table.insert(threads, {
+            compartment = "stress",
+            priority = 2,
+            entry_point = "stress_prefix_reader",
+            stack_size = 0x700,
+            trusted_stack_frames = 3
+        })
+        target:values_set("threads", threads, {expand = false})
+    end)
+
+-- Firmware image for the parser benchmark.  This is not built by
+-- default, and the number of times each payload is parsed can be set
+-- with
+--   xmake config --parser-bench-iterations=<n>
+-- See parser_bench/host for a build of the same benchmark to run on
+-- the host.
+firmware("config-broker-ibex-parser-bench")
+    set_default(false)
+    add_deps("freestanding", "debug", "string")
+
+    -- libraries
+    add_deps("json_parser")
+    add_deps("cbor_parser")
+
+    -- compartments
+    add_deps("parser_bench")
+    on_load(function(target)
+        target:values_set("board", "$(board)")
+        target:values_set("threads", {
+            {
+                -- Thread to run the parsers over each corpus
+                -- and report the results.
+                compartment = "parser_bench",
+                priority = 1,
+                entry_point = "parser_bench_run",
+                stack_size = 0x1000,
+                trusted_stack_frames = 4
+            },
+        }, {expand = false})
+    end)
@@ -162,51 +162,79 @@ namespace
 
 		// Configure the controller
 		auto config = static_cast<userLed::Config *>(newConfig);
-		Debug::log("User LEDs: {} {} {} {} {} {} {} {}",
-		           config->led0,
-		           config->led1,
-		           config->led2,
-		           config->led3,
-		           config->led4,
-		           config->led5,
-		           config->led6,
-		           config->led7);
-
-		setLED(0, config->led0);
-		setLED(1, config->led1);
-		setLED(2, config->led2);
-		setLED(3, config->led3);
-		setLED(4, config->led4);
-		setLED(5, config->led5);
-		setLED(6, config->led6);
-		setLED(7, config->led7);
+		for (size_t i = 0; i < userLed::NumLeds; i++)
+		{
+			setLED(i, config->leds[i]);
+		}
 		return 0;
 	}
 
+	/**
+	 * Handle the items in one lane, restarting after any error.
+	 */
+	void run_lane(int16_t lane, uint32_t coalesceMs)
+	{
+		// List of configuration items we are tracking.  The LED items
+		// are handled by their own thread (lane 1) so that they are not
+		// held up by the LCD redraw, and we note if they take more than
+		// 50ms to take effect.  The capability macros can't be used to
+		// initialise a table at file scope, so each lane builds its own.
+		ConfigConsumer::ConfigItem configItems[] = {
+		  {.capability   = READ_CONFIG_CAPABILITY(SYSTEM_CONFIG),
+		   .handler      = system_config_handler,
+		   .version      = 0,
+		   .versionFutex = nullptr},
+		  {.capability   = READ_CONFIG_CAPABILITY(RGB_LED_CONFIG),
+		   .handler      = rgb_led_handler,
+		   .version      = 0,
+		   .versionFutex = nullptr,
+		   .priority     = 1,
+		   .lane         = 1,
+		   .deadlineMs   = 50},
+		  {.capability   = READ_CONFIG_CAPABILITY(USER_LED_CONFIG),
+		   .handler      = user_led_handler,
+		   .version      = 0,
+		   .versionFutex = nullptr,
+		   .priority     = 1,
+		   .lane         = 1,
+		   .deadlineMs   = 50},
+		};
+
+		constexpr size_t NumOfItems =
+		  sizeof(configItems) / sizeof(configItems[0]);
+
+		// Keep the multi waiter across restarts
+		MultiWaiter mw = nullptr;
+
+		ConfigConsumer::RunOptions options;
+		options.multiwaiter = &mw;
+		options.coalesceMs  = coalesceMs;
+		options.lane        = lane;
+
+		while (true)
+		{
+			on_error(
+			  [&]() { ConfigConsumer::run(configItems, NumOfItems, options); },
+			  [&]() { Debug::log("Unexpected error in Consumer lane {}", lane); });
+		}
+	}
+
 } // namespace
 
 /**
- * Thread entry point.  The waits for changes to one
- * or more configuration values and then calls the
- * appropriate handler.
+ * Thread entry point for the LCD.  The provider may send several
+ * items in quick succession, so wait for them all before redrawing
+ * the LCD (which runs with interrupts disabled).
  */
 void __cheri_compartment("consumers") init()
 {
-	/// List of configuration items we are tracking
-	ConfigConsumer::ConfigItem configItems[] = {
-	  {READ_CONFIG_CAPABILITY(SYSTEM_CONFIG),
-	   system_config_handler,
-	   0,
-	   nullptr},
-	  {READ_CONFIG_CAPABILITY(RGB_LED_CONFIG), rgb_led_handler, 0, nullptr},
-	  {READ_CONFIG_CAPABILITY(USER_LED_CONFIG), user_led_handler, 0, nullptr},
-	};
-
-	size_t numOfItems = sizeof(configItems) / sizeof(configItems[0]);
-
-	while (true)
-	{
-		on_error([&]() { ConfigConsumer::run(configItems, numOfItems); },
-		         [&]() { Debug::log("Unexpected error in Consumer"); });
-	}
+	run_lane(0, 100);
+}
+
+/**
+ * Thread entry point for the LEDs.
+ */
+void __cheri_compartment("consumers") leds()
+{
+	run_lane(1, 0);
 }
@@ -20,6 +20,7 @@ using Debug = ConditionalDebug<true, "Parser Init">;
 int __cheri_compartment("parser_rgb_led") parse_rgb_led_init();
 int __cheri_compartment("parser_user_led") parse_user_led_init();
 int __cheri_compartment("parser_system_config") parse_system_config_init();
+int __cheri_compartment("parser_led") parse_led_init();
 
 // Next step in initialisation
 int __cheri_compartment("system_config") system_config_run();
@@ -31,6 +32,7 @@ void __cheri_compartment("parser_init") parser_init()
 	auto res = parse_user_led_init();
 	res      = std::min(res, parse_rgb_led_init());
 	res      = std::min(res, parse_system_config_init());
+	res      = std::min(res, parse_led_init());
 
 	if (res == 0)
 	{
@@ -4,6 +4,7 @@
 #include "cdefs.h"
 #include <compartment.h>
 #include <debug.hh>
+#include <riscvreg.h>
 #include <thread.h>
 #include <tick_macros.h>
 
@@ -24,6 +25,9 @@ DEFINE_WRITE_CONFIG_CAPABILITY(RGB_LED_CONFIG)
 #define USER_LED_CONFIG "user_led"
 DEFINE_WRITE_CONFIG_CAPABILITY(USER_LED_CONFIG)
 
+#define LED_CONFIG "led"
+DEFINE_WRITE_CONFIG_CAPABILITY(LED_CONFIG)
+
 namespace
 {
 
@@ -38,7 +42,7 @@ namespace
 
 	// We can't use the macros at the file level to statically
 	// initialise configItemMap, so do it via a function
-	Config configItemMap[2];
+	Config configItemMap[3];
 	void   set_up_name_map()
 	{
 		static bool init = false;
@@ -50,6 +54,9 @@ namespace
 			configItemMap[1].name = "user_LED";
 			configItemMap[1].cap  = WRITE_CONFIG_CAPABILITY(USER_LED_CONFIG);
 
+			configItemMap[2].name = "LED";
+			configItemMap[2].cap  = WRITE_CONFIG_CAPABILITY(LED_CONFIG);
+
 			init = true;
 		}
 	}
@@ -63,8 +70,14 @@ namespace
 int updateConfig(const char *name,
                  size_t      nameLength,
                  const void *json,
-                 size_t      jsonLength)
+                 size_t      jsonLength,
+                 uint64_t    ingest,
+                 uint64_t    verified)
 {
+	ConfigTrace trace = {};
+	trace.ingest      = (ingest != 0) ? ingest : rdcycle64();
+	trace.verified    = verified;
+
 	std::string_view svName(name, nameLength);
 	std::string_view svJson((char *)json, jsonLength);
 	Debug::log("thread {} update {}: {}", thread_id_get(), svName, svJson);
@@ -82,7 +95,7 @@ int updateConfig(const char *name,
 		if (strncmp(t.name, name, nameLength) == 0)
 		{
 			found = true;
-			res   = set_config(t.cap, (const char *)json, jsonLength);
+			res   = set_config(t.cap, (const char *)json, jsonLength, &trace);
 			if (res < 0)
 			{
 				Debug::log("thread {} Failed to set value for {}",
@@ -6,8 +6,14 @@
  * received on a particular topic. With a real MQTT
  * client this would be the callback registered when
  * subscribing to the topic.
+ *
+ * ingest and verified are the cycle counts (from rdcycle64()) at
+ * which the update was received and its signature checked, if known,
+ * which are passed to the broker to trace the latency of the update.
  */
 int updateConfig(const char *name,
                  size_t      nameLength,
                  const void *jsonload,
-                 size_t      jsonLength);
+                 size_t      jsonLength,
+                 uint64_t    ingest   = 0,
+                 uint64_t    verified = 0);
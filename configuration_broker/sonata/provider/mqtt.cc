@@ -8,6 +8,7 @@
 #include <locks.hh>
 #include <mqtt.h>
 #include <platform-entropy.hh>
+#include <riscvreg.h>
 #include <sntp.h>
 #include <tick_macros.h>
 #include <unwind.h>
@@ -88,6 +89,7 @@ void __cheri_callback publishCallback(const char *topic,
                                       const void *payload,
                                       size_t      payloadLength)
 {
+	auto ingest = rdcycle64();
 	Debug::log("Received a message on topic '{}'",
 	           std::string_view{topic, topicLength});
 
@@ -102,7 +104,7 @@ void __cheri_callback publishCallback(const char *topic,
 		auto msg = SIGNATURE::verify_signature(payload, payloadLength);
 		if (msg.data != nullptr)
 		{
-			updateConfig(id, idLength, msg.data, msg.length);
+			updateConfig(id, idLength, msg.data, msg.length, ingest, rdcycle64());
 		}
 	}
 	else
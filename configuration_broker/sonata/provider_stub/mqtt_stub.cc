@@ -29,14 +29,7 @@
  * topic: userled
  * --------------
  * {
- *   led0: 'on',
- *   led1: 'off',
- *   led2: 'ON',
- *   led3: 'OFF',
- *   led4: 'Off',
- *   led5: 'On',
- *   led6: 'off',
- *   led7: 'On'
+ *   leds: ['on', 'off', 'ON', 'OFF', 'Off', 'On', 'off', 'On']
  * }
  *
  */
@@ -83,8 +76,8 @@ namespace
 	  {"Valid User LED config",
 	   0,
 	   "userled",
-	   "{\"led0\":\"on\",\"led1\":\"off\",\"led2\":\"ON\",\"led3\":\"OFF\","
-	   " \"led4\":\"On\",\"led5\":\"Off\",\"led6\":\"on\",\"led7\":\"off\"}"},
+	   "{\"leds\":[\"on\",\"off\",\"ON\",\"OFF\","
+	   "          \"On\",\"Off\",\"on\",\"off\"]}"},
 
 	  // Valid RGB LED config
 	  {"Valid RGB LED config",
@@ -97,8 +90,8 @@ namespace
 	  {"Valid User LED config",
 	   0,
 	   "userled",
-	   "{\"led0\":\"OFF\",\"led1\":\"ON\",\"led2\":\"off\",\"led3\":\"on\","
-	   " \"led4\":\"Off\",\"led5\":\"On\",\"led6\":\"off\",\"led7\":\"on\"}"},
+	   "{\"leds\":[\"OFF\",\"ON\",\"off\",\"on\","
+	   "          \"Off\",\"On\",\"off\",\"on\"]}"},
 
 	  // Invalid RGB LED config
 	  {"Invalid RGB LED config",
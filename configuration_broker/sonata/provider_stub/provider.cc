@@ -4,6 +4,7 @@
 #include "cdefs.h"
 #include <compartment.h>
 #include <debug.hh>
+#include <riscvreg.h>
 #include <thread.h>
 #include <tick_macros.h>
 
@@ -66,8 +67,14 @@ namespace
 int updateConfig(const char *name,
                  size_t      nameLength,
                  const void *json,
-                 size_t      jsonLength)
+                 size_t      jsonLength,
+                 uint64_t    ingest,
+                 uint64_t    verified)
 {
+	ConfigTrace trace = {};
+	trace.ingest      = (ingest != 0) ? ingest : rdcycle64();
+	trace.verified    = verified;
+
 	std::string_view svName(name, nameLength);
 	std::string_view svJson((char *)json, jsonLength);
 	Debug::log("thread {} got {} on {}", thread_id_get(), svName, svJson);
@@ -85,7 +92,7 @@ int updateConfig(const char *name,
 		if (strncmp(t.name, name, nameLength) == 0)
 		{
 			found = true;
-			res   = set_config(t.cap, (const char *)json, jsonLength);
+			res   = set_config(t.cap, (const char *)json, jsonLength, &trace);
 			if (res < 0)
 			{
 				Debug::log("thread {} Failed to set value for {}",
@@ -20,6 +20,7 @@ includes("../../network-stack/lib")
 
 -- Common libraries and compartments
 includes("../../third_party/json_parser")
+includes("../../third_party/cbor_parser")
 includes("../../third_party/crypto")
 includes("../common/config_broker") 
 includes("../common/config_consumer")
@@ -37,6 +38,7 @@ includes("provider")
 includes("../config/parsers/rgb_led")
 includes("../config/parsers/user_led")
 includes("../config/parsers/system_config")
+includes("../config/parsers/led")
 
 -- Consumers
 includes("consumers")
@@ -47,6 +49,7 @@ firmware("config-broker-sonata")
 
     -- libraries
     add_deps("json_parser")
+    add_deps("cbor_parser")
     add_deps("crypto")
     add_deps("config_consumer")
 
@@ -63,6 +66,7 @@ firmware("config-broker-sonata")
     add_deps("parser_system_config")
     add_deps("parser_rgb_led")
     add_deps("parser_user_led")
+    add_deps("parser_led")
     
     add_deps("consumers")
     
@@ -98,6 +102,16 @@ firmware("config-broker-sonata")
                 stack_size = 0x500,
                 trusted_stack_frames = 8
             },
+            {
+                -- Thread to consume LED config
+                -- updates, so they are not held
+                -- up by the LCD
+                compartment = "consumers",
+                priority = 2,
+                entry_point = "leds",
+                stack_size = 0x500,
+                trusted_stack_frames = 8
+            },
             {
                 -- TCP/IP stack thread.
                 compartment = "TCPIP",
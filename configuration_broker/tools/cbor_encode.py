@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+# Copyright Configured Things Ltd and CHERIoT Contributors.
+# SPDX-License-Identifier: MIT
+
+"""
+Encode a JSON config value as CBOR, in the subset accepted by
+third_party/cbor_parser, so it can be published in place of the
+JSON.  For example:
+
+    ./cbor_encode.py rgb_led.json -o rgb_led.cbor
+    echo '{"leds": ["on", ...]}' | ./cbor_encode.py --hex
+
+Integers, strings, booleans, null, arrays and objects are encoded
+with the shortest form of each header.  The subset has no floating
+point, so fixed point values must be given already scaled (i.e.
+1.25 with two fraction digits as 125).
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+
+def header(major, argument):
+    """Encode the initial byte and argument of an item."""
+    if argument < 24:
+        return bytes([(major << 5) | argument])
+    for info, fmt in ((24, ">B"), (25, ">H"), (26, ">I"), (27, ">Q")):
+        if argument < (1 << (8 * struct.calcsize(fmt))):
+            return bytes([(major << 5) | info]) + struct.pack(fmt, argument)
+    raise ValueError(f"{argument} is too large for CBOR")
+
+
+def encode(value):
+    """Encode a value parsed from JSON."""
+    # bool is a subclass of int, so has to be checked first
+    if value is False:
+        return b"\xf4"
+    if value is True:
+        return b"\xf5"
+    if value is None:
+        return b"\xf6"
+    if isinstance(value, int):
+        if value >= 0:
+            return header(0, value)
+        return header(1, -1 - value)
+    if isinstance(value, float):
+        raise ValueError(f"{value}: floating point is not in the subset, "
+                         "scale fixed point values to integers")
+    if isinstance(value, str):
+        data = value.encode("utf-8")
+        return header(3, len(data)) + data
+    if isinstance(value, list):
+        return header(4, len(value)) + b"".join(encode(v) for v in value)
+    if isinstance(value, dict):
+        return header(5, len(value)) + b"".join(
+            encode(k) + encode(v) for k, v in value.items())
+    raise ValueError(f"Can't encode {value!r}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("input", nargs="?", type=argparse.FileType("r"),
+                        default=sys.stdin, help="JSON file (default stdin)")
+    parser.add_argument("-o", "--output", type=argparse.FileType("wb"),
+                        default=sys.stdout.buffer,
+                        help="CBOR file (default stdout)")
+    parser.add_argument("--hex", action="store_true",
+                        help="write the CBOR as hex rather than binary")
+    args = parser.parse_args()
+
+    value = json.load(args.input)
+    if not isinstance(value, dict):
+        sys.exit("The config value must be a JSON object")
+
+    try:
+        cbor = encode(value)
+    except ValueError as e:
+        sys.exit(str(e))
+
+    if args.hex:
+        args.output.write(cbor.hex().encode() + b"\n")
+    else:
+        args.output.write(cbor)
+
+    text = json.dumps(value, separators=(",", ":"))
+    print(f"{len(text)} bytes of JSON as {len(cbor)} bytes of CBOR",
+          file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,185 @@
+#!/usr/bin/env python3
+# Copyright Configured Things Ltd and CHERIoT Contributors.
+# SPDX-License-Identifier: MIT
+
+"""
+Compile a JSON config value offline into a blob holding the binary
+layout of the config struct, prefixed with the hash of its schema,
+so the device only has to range check the fields.  For example:
+
+    ./config_blob.py schemas/rgb_led.json rgb_led.json -o rgb_led.blob
+
+The blob can then be signed and published in place of the JSON.
+
+The schema files in schemas/ describe the same layout as the
+CONFIG_SCHEMA in config/include/*.h.  The hash is computed the same
+way as config_schema_hash(), so if the two disagree the device will
+reject the blob (and log the hash it expected) rather than
+misinterpret it.  Use --hash to print the hash of a schema file.
+"""
+
+import argparse
+import decimal
+import json
+import struct
+import sys
+
+BLOB_TAG = 0xFE
+BLOB_VERSION = 1
+
+# Must match the order of ConfigFieldType
+NUMBER, ENUM, STRING = 0, 1, 2
+
+INTEGERS = {
+    "int8": (1, True),
+    "uint8": (1, False),
+    "int16": (2, True),
+    "uint16": (2, False),
+    "int32": (4, True),
+    "uint32": (4, False),
+}
+
+
+class Field:
+    """A field of a schema, with the defaults filled in."""
+
+    def __init__(self, desc):
+        self.path = desc["path"]
+        self.offset = desc["offset"]
+        self.fraction = desc.get("fraction", 0)
+        # Number of elements of an array field, 0 if not an array
+        self.count = desc.get("count", 0)
+        self.names = {}
+        kind = desc["type"]
+        if kind in INTEGERS:
+            self.type = NUMBER
+            self.size, self.signed = INTEGERS[kind]
+            bits = 8 * self.size
+            low = -(1 << (bits - 1)) if self.signed else 0
+            high = (1 << (bits - 1)) - 1 if self.signed else (1 << bits) - 1
+            self.min = desc.get("min", low)
+            self.max = desc.get("max", high)
+        elif kind == "enum":
+            # An enum class defaults to an int
+            self.type = ENUM
+            self.size = desc.get("size", 4)
+            self.signed = desc.get("signed", True)
+            self.names = {k.lower(): v for k, v in desc["names"].items()}
+            self.min = self.max = 0
+        elif kind == "string":
+            self.type = STRING
+            self.size = desc["size"]
+            self.signed = False
+            self.min = self.max = 0
+        else:
+            raise ValueError(f"{self.path}: unknown type {kind}")
+
+    def length(self):
+        """Number of bytes taken by the field."""
+        return self.size * max(self.count, 1)
+
+    def encode(self, value):
+        """Convert a JSON value into the bytes of the field, which for
+        an array field must be a list with a value for each element."""
+        if self.count == 0:
+            return self.encode_element(value)
+        if not isinstance(value, list) or len(value) != self.count:
+            raise ValueError(f"Expected {self.count} values for {self.path}")
+        return b"".join(self.encode_element(v) for v in value)
+
+    def encode_element(self, value):
+        """Convert a single JSON value into bytes."""
+        if self.type == NUMBER:
+            if isinstance(value, bool) or not isinstance(value, (int, float)):
+                raise ValueError(f"{self.path} is not a number")
+            # Truncate any extra fraction digits, as the device does
+            scaled = decimal.Decimal(str(value)).scaleb(self.fraction)
+            number = int(scaled.to_integral_value(decimal.ROUND_DOWN))
+            if self.fraction == 0 and scaled != number:
+                raise ValueError(f"{self.path} is not an integer")
+            if not self.min <= number <= self.max:
+                raise ValueError(f"Value {value} for {self.path} out of range")
+            return number.to_bytes(self.size, "little", signed=self.signed)
+        if self.type == ENUM:
+            if isinstance(value, str):
+                if value.lower() not in self.names:
+                    raise ValueError(f"Invalid enum value {value} for "
+                                     f"{self.path}")
+                number = self.names[value.lower()]
+            elif isinstance(value, int) and value in self.names.values():
+                number = value
+            else:
+                raise ValueError(f"Invalid enum value {value} for {self.path}")
+            return number.to_bytes(self.size, "little", signed=self.signed)
+        data = value.encode("utf-8") if isinstance(value, str) else None
+        if data is None or len(data) >= self.size:
+            raise ValueError(f"Invalid string for {self.path}")
+        return data.ljust(self.size, b"\0")
+
+
+def schema_hash(fields, size):
+    """FNV-1a hash of the layout, as config_schema_hash()."""
+    data = b""
+    for f in fields:
+        data += f.path.encode() + b"\0"
+        data += struct.pack("<IIBBBBqq", f.offset, f.size, f.type,
+                            f.signed, f.fraction, f.count, f.min, f.max)
+    data += struct.pack("<I", size)
+    h = 2166136261
+    for b in data:
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def lookup(value, path):
+    """Find the value at a dotted path in a JSON object."""
+    for key in path.split("."):
+        if not isinstance(value, dict) or key not in value:
+            raise ValueError(f"Missing key {path}")
+        value = value[key]
+    return value
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("schema", type=argparse.FileType("r"),
+                        help="schema file from tools/schemas")
+    parser.add_argument("input", nargs="?", type=argparse.FileType("r"),
+                        default=sys.stdin, help="JSON value (default stdin)")
+    parser.add_argument("-o", "--output", type=argparse.FileType("wb"),
+                        default=sys.stdout.buffer,
+                        help="blob file (default stdout)")
+    parser.add_argument("--hash", action="store_true",
+                        help="only print the hash of the schema")
+    args = parser.parse_args()
+
+    desc = json.load(args.schema)
+    size = desc["size"]
+    try:
+        fields = [Field(f) for f in desc["fields"]]
+    except (KeyError, ValueError) as e:
+        sys.exit(f"Invalid schema: {e}")
+    for f in fields:
+        if f.offset + f.length() > size:
+            sys.exit(f"Invalid schema: {f.path} is outside the struct")
+    h = schema_hash(fields, size)
+
+    if args.hash:
+        print(f"{desc['type']}: {h:#010x} ({h})")
+        return
+
+    value = json.load(args.input)
+    body = bytearray(size)
+    try:
+        for f in fields:
+            body[f.offset:f.offset + f.length()] = f.encode(
+                lookup(value, f.path))
+    except ValueError as e:
+        sys.exit(str(e))
+
+    header = struct.pack("<BBHI", BLOB_TAG, BLOB_VERSION, 0, h)
+    args.output.write(header + bytes(body))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,208 @@
+// Copyright Configured Things Ltd and CHERIoT Contributors.
+// SPDX-License-Identifier: MIT
+
+// A decoder for the subset of CBOR used for compact config
+// payloads, as a CHERIoT library.
+
+#include "cbor_parser.h"
+
+using namespace cborParser;
+
+namespace
+{
+
+	/// Major types from the high three bits of the initial byte.
+	enum Major : uint8_t
+	{
+		MajorUnsigned = 0,
+		MajorNegative = 1,
+		MajorBytes    = 2,
+		MajorText     = 3,
+		MajorArray    = 4,
+		MajorMap      = 5,
+		MajorTag      = 6,
+		MajorSimple   = 7,
+	};
+
+	/// Simple values in the subset.
+	constexpr uint8_t SimpleFalse = 20;
+	constexpr uint8_t SimpleTrue  = 21;
+	constexpr uint8_t SimpleNull  = 22;
+
+	/**
+	 * Decode the header of the item at offset, i.e. its type and
+	 * argument, and move offset past it.  For a string also checks
+	 * the contents fit in buf and moves past them.  Returns the
+	 * number of elements that follow as part of the item (so 2n for
+	 * a map of n pairs), or -1 if it is malformed or not in the
+	 * subset.
+	 */
+	int64_t
+	header(const uint8_t *buf, size_t length, size_t &offset, CborItem &item)
+	{
+		if (offset >= length)
+		{
+			return -1;
+		}
+		uint8_t initial = buf[offset++];
+		uint8_t major   = initial >> 5;
+		uint8_t info    = initial & 0x1f;
+
+		uint64_t argument = info;
+		if (info >= 24)
+		{
+			// 24..27 are followed by a 1, 2, 4 or 8 byte big endian
+			// argument, anything else is reserved or indefinite.
+			if (info > 27)
+			{
+				return -1;
+			}
+			size_t bytes = size_t{1} << (info - 24);
+			if (bytes > length - offset)
+			{
+				return -1;
+			}
+			argument = 0;
+			for (size_t i = 0; i < bytes; i++)
+			{
+				argument = (argument << 8) | buf[offset++];
+			}
+		}
+
+		item.value = argument;
+		item.data  = &buf[offset];
+		item.size  = 0;
+
+		// Every element takes at least one byte, so no valid count can
+		// be larger than what is left.  Checking this here also stops
+		// the count of elements still to come from overflowing.
+		size_t left = length - offset;
+
+		switch (major)
+		{
+			case MajorUnsigned:
+				item.type = CborType::Unsigned;
+				return 0;
+
+			case MajorNegative:
+				item.type = CborType::Negative;
+				return 0;
+
+			case MajorBytes:
+			case MajorText:
+				item.type = (major == MajorText) ? CborType::Text
+				                                 : CborType::Bytes;
+				if (argument > left)
+				{
+					return -1;
+				}
+				item.size = argument;
+				offset += argument;
+				return 0;
+
+			case MajorArray:
+				item.type = CborType::Array;
+				return (argument > left) ? -1 : argument;
+
+			case MajorMap:
+				item.type = CborType::Map;
+				return (argument > left / 2) ? -1 : argument * 2;
+
+			case MajorSimple:
+				if (info == SimpleFalse)
+				{
+					item.type = CborType::False;
+					return 0;
+				}
+				if (info == SimpleTrue)
+				{
+					item.type = CborType::True;
+					return 0;
+				}
+				if (info == SimpleNull)
+				{
+					item.type = CborType::Null;
+					return 0;
+				}
+				return -1;
+
+			default:
+				// Tags are not in the subset
+				return -1;
+		}
+	}
+
+	/**
+	 * Move offset past the item at offset.  Nested items are handled
+	 * by counting the elements still to come rather than by recursion,
+	 * so skipping an item uses the same stack however deeply it is
+	 * nested.  A caller that walks into nested maps, such as the
+	 * binder in parser_helper.h, has to bound its own recursion.
+	 */
+	int skip(const uint8_t *buf, size_t length, size_t &offset, CborItem &item)
+	{
+		uint64_t pending = 1;
+		bool     first   = true;
+		while (pending > 0)
+		{
+			CborItem element;
+			int64_t  elements = header(buf, length, offset, element);
+			if (elements < 0)
+			{
+				return -EINVAL;
+			}
+			if (first)
+			{
+				item  = element;
+				first = false;
+			}
+			pending += elements - 1;
+		}
+		return 0;
+	}
+
+} // namespace
+
+namespace cborParser
+{
+
+	/**
+	 * Check that buf holds exactly one well formed item in the subset.
+	 */
+	int __cheri_libcall validate(const uint8_t *buf, size_t length)
+	{
+		size_t   offset = 0;
+		CborItem item;
+		if (skip(buf, length, offset, item) != 0 || offset != length)
+		{
+			return -EINVAL;
+		}
+		return 0;
+	}
+
+	/*
+	 * Decode the item at *offset in buf.
+	 */
+	int __cheri_libcall next(const uint8_t *buf,
+	                         size_t         length,
+	                         size_t        *offset,
+	                         CborItem      *item)
+	{
+		if (*offset >= length)
+		{
+			return -ENOENT;
+		}
+		size_t end = *offset;
+		if (skip(buf, length, end, *item) != 0)
+		{
+			return -EINVAL;
+		}
+		if (item->type == CborType::Array || item->type == CborType::Map)
+		{
+			item->size = &buf[end] - item->data;
+		}
+		*offset = end;
+		return 0;
+	}
+
+} // namespace cborParser
@@ -0,0 +1,90 @@
+// Copyright Configured Things Ltd and CHERIoT Contributors.
+// SPDX-License-Identifier: MIT
+#pragma once
+
+// A decoder for the subset of CBOR (RFC 8949) used for compact
+// config payloads, as a CHERIoT library.
+//
+// The subset covers unsigned and negative integers, byte and text
+// strings, arrays, maps, and the simple values false, true and null,
+// all with definite lengths.  Tags, floating point and indefinite
+// length items are rejected.
+
+#include <cdefs.h>
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace cborParser
+{
+
+	/**
+	 * Types of item in the subset.
+	 */
+	enum class CborType : uint8_t
+	{
+		Unsigned,
+		Negative,
+		Bytes,
+		Text,
+		Array,
+		Map,
+		False,
+		True,
+		Null,
+	};
+
+	/**
+	 * A decoded item.  For an integer value holds the argument, so a
+	 * Negative item has the value -1 - value.  For a string value is
+	 * the length and data points to the contents, and for an array or
+	 * map value is the number of elements (or pairs) and data points
+	 * to the first of them, with size the encoded size of all of them.
+	 */
+	struct CborItem
+	{
+		CborType       type;
+		uint64_t       value;
+		const uint8_t *data;
+		size_t         size;
+	};
+
+	/**
+	 * Check that buf holds exactly one well formed item in the subset.
+	 * Returns 0 if it does, or -EINVAL.
+	 */
+	int __cheri_libcall validate(const uint8_t *buf, size_t length);
+
+	/*
+	 * Decode the item at *offset in buf, and move offset past it
+	 * (including any elements of an array or map).  Returns 0 on
+	 * success, -ENOENT at the end of buf, or -EINVAL if the item
+	 * is malformed.
+	 */
+	int __cheri_libcall next(const uint8_t *buf,
+	                         size_t         length,
+	                         size_t        *offset,
+	                         CborItem      *item);
+
+	/*
+	 * Get the value of an integer item, checking it fits in an
+	 * int64_t.  Returns 0 on success, -EINVAL if the item is not an
+	 * integer, or -ERANGE.
+	 */
+	inline int to_int64(const CborItem &item, int64_t *out)
+	{
+		if (item.type != CborType::Unsigned && item.type != CborType::Negative)
+		{
+			return -EINVAL;
+		}
+		if (item.value > static_cast<uint64_t>(INT64_MAX))
+		{
+			return -ERANGE;
+		}
+		*out = (item.type == CborType::Unsigned)
+		         ? static_cast<int64_t>(item.value)
+		         : -1 - static_cast<int64_t>(item.value);
+		return 0;
+	}
+
+} // namespace cborParser
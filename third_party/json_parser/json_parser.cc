@@ -6,6 +6,90 @@
 
 #include "./coreJSON/core_json.h"
 
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace
+{
+
+	/**
+	 * Check four characters are all digits.  Adding 6 to a digit
+	 * leaves the high nibble as 3, but carries anything above '9'.
+	 */
+	bool all_digits(uint32_t chars)
+	{
+		return ((chars & 0xf0f0f0f0) == 0x30303030) &&
+		       (((chars + 0x06060606) & 0xf0f0f0f0) == 0x30303030);
+	}
+
+	/**
+	 * Convert four digits, the first of which is in the low byte, by
+	 * combining them in pairs and then combining the pairs.
+	 */
+	uint32_t four_digits(uint32_t chars)
+	{
+		chars -= 0x30303030;
+		chars = ((chars * 10) + (chars >> 8)) & 0x00ff00ff;
+		return ((chars * 100) + (chars >> 16)) & 0xffff;
+	}
+
+	/**
+	 * Add length digits at value to acc, four at a time where
+	 * possible.  Returns -EINVAL if any of them is not a digit, or
+	 * -ERANGE if acc overflows.
+	 */
+	int accumulate(const char *value, size_t length, uint64_t &acc)
+	{
+		size_t i = 0;
+		for (; i + 4 <= length; i += 4)
+		{
+			uint32_t chars;
+			memcpy(&chars, &value[i], sizeof(chars));
+			if (!all_digits(chars))
+			{
+				return -EINVAL;
+			}
+			if (__builtin_mul_overflow(acc, 10000, &acc) ||
+			    __builtin_add_overflow(acc, four_digits(chars), &acc))
+			{
+				return -ERANGE;
+			}
+		}
+		for (; i < length; i++)
+		{
+			char c = value[i];
+			if (c < '0' || c > '9')
+			{
+				return -EINVAL;
+			}
+			if (__builtin_mul_overflow(acc, 10, &acc) ||
+			    __builtin_add_overflow(acc, c - '0', &acc))
+			{
+				return -ERANGE;
+			}
+		}
+		return 0;
+	}
+
+	/**
+	 * Apply the sign to the magnitude of a number, checking it fits
+	 * in an int64_t.
+	 */
+	int apply_sign(uint64_t magnitude, bool negative, int64_t *out)
+	{
+		if (magnitude > (negative ? static_cast<uint64_t>(INT64_MAX) + 1
+		                          : static_cast<uint64_t>(INT64_MAX)))
+		{
+			return -ERANGE;
+		}
+		*out = negative ? static_cast<int64_t>(0 - magnitude)
+		                : static_cast<int64_t>(magnitude);
+		return 0;
+	}
+
+} // namespace
+
 namespace jsonParser
 {
 
@@ -32,4 +116,111 @@ namespace jsonParser
 		  buf, max, query, queryLength, outValue, outValueLength);
 	}
 
+	/*
+	 * Get the next key-value pair (or value, for an array) from
+	 * the collection in buf.
+	 */
+	JSONStatus_t __cheri_libcall iterate(const char *buf,
+	                                     size_t      max,
+	                                     size_t     *start,
+	                                     size_t     *next,
+	                                     JSONPair_t *outPair)
+	{
+		return JSON_Iterate(buf, max, start, next, outPair);
+	}
+
+	/*
+	 * Convert a JSON integer value to a number.
+	 */
+	int __cheri_libcall to_int64(const char *value,
+	                             size_t      valueLength,
+	                             int64_t    *out)
+	{
+		bool   negative = (valueLength > 0 && value[0] == '-');
+		size_t start    = negative ? 1 : 0;
+		if (start == valueLength)
+		{
+			return -EINVAL;
+		}
+
+		uint64_t magnitude = 0;
+		int      res =
+		  accumulate(&value[start], valueLength - start, magnitude);
+		if (res != 0)
+		{
+			return res;
+		}
+		return apply_sign(magnitude, negative, out);
+	}
+
+	/*
+	 * Convert a JSON number value to fixed point.
+	 */
+	int __cheri_libcall to_fixed(const char *value,
+	                             size_t      valueLength,
+	                             uint8_t     fractionDigits,
+	                             int64_t    *out)
+	{
+		if (fractionDigits > 9)
+		{
+			return -EINVAL;
+		}
+
+		bool   negative = (valueLength > 0 && value[0] == '-');
+		size_t start    = negative ? 1 : 0;
+		size_t intEnd   = start;
+		while (intEnd < valueLength && value[intEnd] != '.')
+		{
+			intEnd++;
+		}
+		if (start == intEnd)
+		{
+			return -EINVAL;
+		}
+
+		uint64_t magnitude = 0;
+		int      res = accumulate(&value[start], intEnd - start, magnitude);
+		if (res != 0)
+		{
+			return res;
+		}
+
+		// Take up to fractionDigits digits after the point, and pad
+		// with zeros if there are fewer.
+		size_t fractionLength = 0;
+		if (intEnd < valueLength)
+		{
+			auto   fraction = &value[intEnd + 1];
+			size_t length   = valueLength - intEnd - 1;
+			if (length == 0)
+			{
+				return -EINVAL;
+			}
+			fractionLength = (length < fractionDigits) ? length : fractionDigits;
+			res            = accumulate(fraction, fractionLength, magnitude);
+			if (res != 0)
+			{
+				return res;
+			}
+
+			// The truncated digits still have to be digits
+			for (size_t i = fractionLength; i < length; i++)
+			{
+				if (fraction[i] < '0' || fraction[i] > '9')
+				{
+					return -EINVAL;
+				}
+			}
+		}
+		for (size_t i = fractionLength; i < fractionDigits; i++)
+		{
+			if (__builtin_mul_overflow(magnitude, 10, &magnitude))
+			{
+				return -ERANGE;
+			}
+		}
+
+		return apply_sign(magnitude, negative, out);
+	}
+
 } // namespace jsonParser
@@ -6,6 +6,9 @@
 
 #include "./coreJSON/core_json.h"
 
+#include <errno.h>
+#include <stdint.h>
+
 namespace jsonParser
 {
 
@@ -25,4 +28,79 @@ namespace jsonParser
 	                                    char      **outValue,
 	                                    size_t     *outValueLength);
 
+	/*
+	 * Get the next key-value pair (or value, for an array) from
+	 * the collection in buf.  start and next should both be zero
+	 * for the first call, and returns JSONNotFound at the end of
+	 * the collection.
+	 */
+	JSONStatus_t __cheri_libcall iterate(const char *buf,
+	                                     size_t      max,
+	                                     size_t     *start,
+	                                     size_t     *next,
+	                                     JSONPair_t *outPair);
+
+	/*
+	 * Convert a JSON integer value (as returned by search or iterate)
+	 * to a number.  Returns 0 on success, -EINVAL if the value is not
+	 * an integer, or -ERANGE if it does not fit in an int64_t.
+	 */
+	int __cheri_libcall to_int64(const char *value,
+	                             size_t      valueLength,
+	                             int64_t    *out);
+
+	/*
+	 * Convert a JSON number value to fixed point, i.e. scaled by
+	 * 10^fractionDigits (which must be at most 9), so "1.25" with
+	 * two fraction digits is 125.  Any further fraction digits are
+	 * truncated.  Returns 0 on success, -EINVAL if the value is not a
+	 * number or has an exponent, or -ERANGE if it does not fit in an
+	 * int64_t.
+	 */
+	int __cheri_libcall to_fixed(const char *value,
+	                             size_t      valueLength,
+	                             uint8_t     fractionDigits,
+	                             int64_t    *out);
+
+	/*
+	 * Convert a JSON number value and check it is in the range
+	 * min..max.  Returns 0 on success, -EINVAL if the value is not
+	 * an integer, or -ERANGE if it is out of range.
+	 */
+	inline int to_number(const char *value,
+	                     size_t      valueLength,
+	                     int64_t     min,
+	                     int64_t     max,
+	                     int64_t    *out)
+	{
+		int res = to_int64(value, valueLength, out);
+		if (res == 0 && (*out < min || *out > max))
+		{
+			res = -ERANGE;
+		}
+		return res;
+	}
+
+	inline int to_int32(const char *value, size_t valueLength, int32_t *out)
+	{
+		int64_t v;
+		int     res = to_number(value, valueLength, INT32_MIN, INT32_MAX, &v);
+		if (res == 0)
+		{
+			*out = v;
+		}
+		return res;
+	}
+
+	inline int to_uint32(const char *value, size_t valueLength, uint32_t *out)
+	{
+		int64_t v;
+		int     res = to_number(value, valueLength, 0, UINT32_MAX, &v);
+		if (res == 0)
+		{
+			*out = v;
+		}
+		return res;
+	}
+
 } // namespace jsonParser